@@ -1,25 +1,53 @@
 #include <avr/wdt.h>
 #include "config.h"
+#include "sysclock.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "watchdog.h"
+#include "power.h"
+#include "debounce.h"
 #include "custom_interface.h"
 
-#define TEST 1
+//1 - human readable printInfo() instead of binary telemetry, blocks the loop while printing
+#define TEST 0
+//1 - sleep in idle mode between scheduler ticks
+#define SLEEP_WHEN_IDLE 1
+const unsigned long PRINT_EVERY_MS = 4000;
 //auxiliary variable for serial printing
-unsigned int i = 0;
+unsigned long lastPrintMs = 0;
 
 void setup() 
 { 
-  if(TEST) Serial.begin(9600);
+  watchdog::start();
+  power::start();
+  Serial.begin(9600);
+  sysclock::update();
+  profiler::start();
+  debounce::start();
+  interface::restoreState();
+  interface::scheduleTasks();
+
+  telemetry::Record reset(telemetry::RECORD_RESET);
+  if(watchdog::writeTelemetry(reset)) telemetry::send(reset);
 }
 
 void loop()
 {
-  ++i;
-
-  //watch dog enable
-  wdt_enable(WDTO_1S);
+  watchdog::mark(watchdog::STAGE_CONTROL);
   interface::readAndControl();  //set of functions grouped in order do read sensors and control pumps
   wdt_reset();
 
-  if(TEST && i%10000 == 0)   //i=10000 is about 4 seconds
-    interface::printInfo();
+  if(sysclock::elapsedMs(lastPrintMs) >= PRINT_EVERY_MS)
+  {
+    lastPrintMs = sysclock::nowMs();
+    watchdog::mark(TEST ? watchdog::STAGE_PRINT : watchdog::STAGE_TELEMETRY);
+    if(TEST) interface::printInfo();
+    else interface::sendTelemetry();
+  }
+  watchdog::mark(watchdog::STAGE_SERIAL);
+  interface::serviceCommands();
+  interface::serviceTrace();
+  telemetry::service();
+
+  if(SLEEP_WHEN_IDLE && interface::idle()) power::sleep();
 }
@@ -0,0 +1,118 @@
+#include <arduino.h>
+#include "adc.h"
+
+namespace
+{
+  struct Channel
+  {
+    uint8_t pin;
+    uint8_t version;
+    int value;
+    uint16_t sum;
+  };
+
+  Channel channels_[ADC_MAX_CHANNELS];
+  uint8_t channelCount_ = 0;
+  volatile uint8_t current_ = 0;
+  volatile uint8_t samples_ = 0;
+  volatile bool busy_ = false;
+
+  Channel* find(const uint8_t pin)
+  {
+    for(uint8_t i = 0; i < channelCount_; ++i)
+      if(channels_[i].pin == pin) return &channels_[i];
+    return nullptr;
+  }
+}
+
+namespace adc
+{
+#if defined(__AVR__)
+  //single conversions chained from the ADC interrupt, prescaler (125 kHz ADC clock) is set up by the core
+  void startConversion(const uint8_t pin)
+  {
+#if defined(analogPinToChannel)
+    uint8_t channel = analogPinToChannel(pin >= A0 ? pin - A0 : pin);
+#else
+    uint8_t channel = pin >= A0 ? pin - A0 : pin;   //Mega: A0..A15 are channels 0..15
+#endif
+
+    ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((channel >> 3) & 0x01) << MUX5);
+    ADMUX = _BV(REFS0) | (channel & 0x07);
+    ADCSRA |= _BV(ADIE) | _BV(ADSC);
+  }
+#endif
+
+  bool addChannel(const uint8_t pin)
+  {
+    if(find(pin)) return true;
+    if(channelCount_ == ADC_MAX_CHANNELS) return false;
+
+    channels_[channelCount_].pin = pin;
+    ++channelCount_;
+    return true;
+  }
+
+  void startRound()
+  {
+    if(busy_ || !channelCount_) return;
+
+    busy_ = true;
+    current_ = 0;
+    samples_ = 0;
+    channels_[0].sum = 0;
+    startConversion(channels_[0].pin);
+  }
+
+  void conversionDone(const int sample)
+  {
+    Channel& ch = channels_[current_];
+
+    ch.sum += sample;
+    if(++samples_ < ADC_OVERSAMPLING)
+    {
+      startConversion(ch.pin);
+      return;
+    }
+
+    int average = (ch.sum + ADC_OVERSAMPLING/2) / ADC_OVERSAMPLING;
+    if(abs(average - ch.value) > ADC_HYSTERESIS || !ch.version)
+    {
+      ch.value = average;
+      ++ch.version;
+      if(!ch.version) ++ch.version;  //0 means never sampled
+    }
+
+    samples_ = 0;
+    if(++current_ < channelCount_)
+    {
+      channels_[current_].sum = 0;
+      startConversion(channels_[current_].pin);
+    }
+    else busy_ = false;
+  }
+
+  int read(const uint8_t pin)
+  {
+    Channel* ch = find(pin);
+    if(!ch) return 0;
+
+    noInterrupts();
+    int value = ch->value;
+    interrupts();
+    return value;
+  }
+
+  uint8_t version(const uint8_t pin)
+  {
+    Channel* ch = find(pin);
+    return ch ? ch->version : 0;
+  }
+}
+
+#if defined(__AVR__)
+ISR(ADC_vect)
+{
+  adc::conversionDone(ADC);
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+
+const int ADC_MAX_CHANNELS = 4;
+const int ADC_OVERSAMPLING = 16;
+const int ADC_HYSTERESIS = 3;
+const int ADC_SAMPLE_MS = 250;
+
+//background sampling of the analog inputs
+//startRound() runs ADC_OVERSAMPLING interrupt driven conversions per channel, the averages
+//are cached and version() changes only when a value moves by more than ADC_HYSTERESIS
+namespace adc
+{
+  bool addChannel(const uint8_t pin);
+  void startRound();
+  int read(const uint8_t pin);
+  uint8_t version(const uint8_t pin);
+
+  //interrupt context
+  void conversionDone(const int sample);
+
+#if !defined(__AVR__)
+  //provided by the host simulation, has to call conversionDone() when the result is ready
+  void startConversion(const uint8_t pin);
+#endif
+}
+
+#endif
@@ -2,7 +2,44 @@
 #define CONFIG_H
 
 #include <arduino.h>
+#include "fastio.h"
 
+//watering zones, soil sensor pins are used only by soil controlled pumps, flowIn only with a calibration
+//the state of a zone takes about 30 bytes of SRAM and 9 (timer) or 13 (soil) bytes of an EEPROM slot, see topology.h for the limit
+struct ZonePins
+{
+  int soil1;
+  int soil2;
+  int switchIn;
+  int relayOut;
+  int flowIn;
+  unsigned int flowPulsesPerL;
+};
+
+#if defined(FASTIO_MEGA)
+//pin set for Arduino Mega, eight zones: switches on port A (22..29), relays on port C (30..37),
+//soil probes on ports L (42..49) and K (A8..A15), flow meters on the external interrupts left free (zones 1-4)
+const int WATER_IN = 2;
+const int AIR_IN = 3;
+const int POT_IN = A0;
+const int BUZZER_OUT = 5;
+const int AIR_LED_OUT = 6;
+
+//flow meter calibration in pulses per litre, 0 - no meter, water is estimated from the running time
+const unsigned int FLOW1_PULSES_PER_L = 0;
+const unsigned int FLOW2_PULSES_PER_L = 0;
+const unsigned int FLOW3_PULSES_PER_L = 0;
+const unsigned int FLOW4_PULSES_PER_L = 0;
+
+const ZonePins ZONE_PINS[] = { {42, A8,  22, 30, 21, FLOW1_PULSES_PER_L},
+                               {43, A9,  23, 31, 20, FLOW2_PULSES_PER_L},
+                               {44, A10, 24, 32, 19, FLOW3_PULSES_PER_L},
+                               {45, A11, 25, 33, 18, FLOW4_PULSES_PER_L},
+                               {46, A12, 26, 34, -1, 0},
+                               {47, A13, 27, 35, -1, 0},
+                               {48, A14, 28, 36, -1, 0},
+                               {49, A15, 29, 37, -1, 0} };
+#else
 //pin set for Arduino Leonardo
 const int SOIL1_IN = 10;
 const int SOIL2_IN = 16;
@@ -17,8 +54,41 @@ const int RELAY1_OUT = 8;
 const int RELAY2_OUT = 9;
 const int BUZZER_OUT = 5;
 const int AIR_LED_OUT = 6;
+const int FLOW1_IN = 0;
+const int FLOW2_IN = 1;
+
+//flow meter calibration in pulses per litre, 0 - no meter, water is estimated from the running time
+const unsigned int FLOW1_PULSES_PER_L = 0;
+const unsigned int FLOW2_PULSES_PER_L = 0;
+
+const ZonePins ZONE_PINS[] = { {SOIL1_IN, SOIL2_IN, SWITCH1_IN, RELAY1_OUT, FLOW1_IN, FLOW1_PULSES_PER_L},
+                               {SOIL3_IN, SOIL4_IN, SWITCH2_IN, RELAY2_OUT, FLOW2_IN, FLOW2_PULSES_PER_L} };
+#endif
+const int ZONE_COUNT = sizeof(ZONE_PINS)/sizeof(ZONE_PINS[0]);
+
+//what turns the pumps on: soil sensors or a timer, the same for all zones (see topology.h)
+enum PumpControl {SOIL_DRIVEN, TIMER_DRIVEN};
+const PumpControl PUMP_CONTROL = TIMER_DRIVEN;
+
+//shared supply: pumps running at once and the shortest time between two starts (inrush current, pressure drop)
+const int MAX_RUNNING_PUMPS = 2;
+const unsigned long PUMP_START_STAGGER_MS = 3000;
 
 //max watering time in one turn on cycle
 const int MAX_WATERING_TIME_SEC = 30;
 
+//cycle and soak: an automatic cycle is split into pulses with the pump stopped for SOAK_SEC
+//between them, so heavy soil takes the water in instead of shedding it - 1 is one continuous run
+//every pulse fills the pipes again (_DELAY_CONSTANT_SEC) and delivers its share of the cycle
+const int PULSES_PER_CYCLE = 1;
+const int SOAK_SEC = 600;
+
+//timer pumps follow the evapotranspiration estimated from the air sensor (see et.h)
+//a day of ET_REFERENCE_MM at ET_REFERENCE_RH gets WATER_PER_DAY_AT_REF_L per zone, the knob scales it from x2 down to x0.25
+//ET_RADIATION_MM - extraterrestrial radiation of the site and season as evaporated water [mm/day]
+const int ET_RADIATION_MM = 15;
+const int ET_REFERENCE_MM = 5;
+const int ET_REFERENCE_RH = 60;
+const int WATER_PER_DAY_AT_REF_L = 20;
+
 #endif
@@ -1,19 +1,30 @@
 #include "config.h"
 #include "sensors.h"
 #include "pumps.h"
+#include "topology.h"
+#include "scheduler.h"
+#include "sysclock.h"
+#include "fastio.h"
+#include "adc.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "persist.h"
+#include "history.h"
 #include "custom_interface.h"
 
 AirSensor air_sensor(AIR_IN, AIR_LED_OUT, digitalPinToInterrupt(AIR_IN), interface::dht11Wrapper);
-//SoilSensorSegment soil_sensor_segment1(SOIL1_IN, SOIL2_IN, 1);
-//SoilSensorSegment soil_sensor_segment2(SOIL3_IN, SOIL4_IN, 2);
-Switch switch1(SWITCH1_IN);
-Switch switch2(SWITCH2_IN);
 WaterSensor water_sensor(WATER_IN, BUZZER_OUT, interface::waterSensorWrapper);
 
-//PumpSS pump1(RELAY1_OUT, POT_IN, MAX_WATERING_TIME_SEC, 1, &switch1, &water_sensor, &air_sensor, &soil_sensor_segment1);
-//PumpSS pump2(RELAY2_OUT, POT_IN, MAX_WATERING_TIME_SEC, 2, &switch2, &water_sensor, &air_sensor, &soil_sensor_segment2);
-PumpWT pump1(RELAY1_OUT, POT_IN, MAX_WATERING_TIME_SEC, 1, &switch1, &water_sensor, &air_sensor);
-PumpWT pump2(RELAY2_OUT, POT_IN, MAX_WATERING_TIME_SEC, 2, &switch2, &water_sensor, &air_sensor);
+//topology comes from ZONE_PINS and PUMP_CONTROL in config.h
+SystemZones zones(ZONE_PINS, &water_sensor, &air_sensor);
+
+//persistent state of all zones, a changed layout does not load
+static_assert(SystemZones::STATE_SIZE <= PERSIST_MAX_PAYLOAD, "zone state does not fit an EEPROM slot");
+
+//zone chunk of the next RECORD_STATUS
+uint8_t telemetryZone = 0;
+
+Scheduler scheduler;
 
 namespace interface
 {
@@ -23,33 +34,178 @@ namespace interface
   }
 
   void waterSensorWrapper()
+  {
+    water_sensor.isrCallback();
+  }
+
+  unsigned long airSensorTask()
+  {
+    air_sensor.readSensor();
+    return air_sensor.nextReadMs();
+  }
+
+  unsigned long soilSensorTask()
+  {
+    zones.readSoil();
+    return zones.soilNextReadMs();
+  }
+
+  unsigned long waterSensorTask()
   {
     water_sensor.readSensor();
+    return water_sensor.nextReadMs();
+  }
+
+  unsigned long waterSensorQuiet()
+  {
+    return water_sensor.quietMs();
   }
 
-  //set of functions for reading sensors and controlling pumps
+  unsigned long adcTask()
+  {
+    adc::startRound();
+    return ADC_SAMPLE_MS;
+  }
+
+  //a round finds the same averages until the knob is turned
+  unsigned long adcQuiet()
+  {
+    return QUIET_MAX_MS;
+  }
+
+  unsigned long pumpTask()
+  {
+    zones.controlPumps();
+    history::notePumps(zones.runningMask());
+    return PUMP_CONTROL_MS;
+  }
+
+  unsigned long pumpQuiet()
+  {
+    return zones.quietMs();
+  }
+
+  //one sample of the sensor history, postponed while a dump streams the ring
+  unsigned long historyTask()
+  {
+    if(history::dumping()) return HISTORY_DUMP_WAIT_MS;
+
+    uint32_t flags = water_sensor.shouldWater() | air_sensor.sensorError() << 1
+                     | (uint32_t)zones.soilDry(0) << HISTORY_PROBE1_SHIFT | (uint32_t)zones.soilDry(1) << HISTORY_PROBE2_SHIFT;
+    history::sample(air_sensor.temperature(), air_sensor.humidity(), flags);
+    return HISTORY_SAMPLE_SEC * 1000;
+  }
+
+  //EEPROM writes trickle in the background, one byte per run
+  unsigned long persistTask()
+  {
+    if(persist::saveDue())
+    {
+      persist::Record record;
+      zones.saveState(record);
+      persist::save(record);
+    }
+    return persist::service();
+  }
+
+  unsigned long persistQuiet()
+  {
+    return persist::quietMs();
+  }
+
+  void restoreState()
+  {
+    persist::Record record;
+    if(!persist::load(record, SystemZones::STATE_SIZE)) return;
+    zones.restoreState(record);
+  }
+
+  //registration order is the execution order within a tick - sensors before pumps
+  void scheduleTasks()
+  {
+    scheduler.addTask(airSensorTask, air_sensor.firstReadMs());
+    if(SystemZones::HAS_SOIL_SENSOR) scheduler.addTask(soilSensorTask, zones.soilFirstReadMs());
+    scheduler.addTask(waterSensorTask, 0, waterSensorQuiet);
+    scheduler.addTask(adcTask, 0, adcQuiet);
+    scheduler.addTask(pumpTask, 0, pumpQuiet);
+    scheduler.addTask(persistTask, PERSIST_IDLE_MS, persistQuiet);
+    scheduler.addTask(historyTask, HISTORY_SAMPLE_SEC * 1000);
+  }
+
+  //set of functions for reading sensors and controlling pumps, only the due ones run
   void readAndControl()
   {
-    air_sensor.readSensor();
-    //soil_sensor_segment1.readSensor();
-    //soil_sensor_segment2.readSensor();
-    switch1.readSensor();
-    switch2.readSensor();
-    pump1.controlPump();
-    pump2.controlPump();
+    sysclock::update();
+    if(!scheduler.isDue()) return;
+
+    uint16_t start = profiler::ticks();
+    fastio::snapshot();
+    scheduler.tick();
+    profiler::record(PROFILER_TICK_STAGE, profiler::ticks() - start);
+  }
+
+  //nothing is due before the next interrupt
+  bool idle()
+  {
+    return !scheduler.isDue();
+  }
+
+  //millis() of the next task run that can change anything while the inputs stay as they are,
+  //the tasks still run on their periods - the host simulation skips virtual time up to it
+  uint32_t nextDueMs()
+  {
+    return scheduler.nextChangeMs();
   }
 
   //wrapper for printing system informarion
   void printInfo()
   {
       air_sensor.printInfo();
-      //soil_sensor_segment1.printInfo();
-      //soil_sensor_segment2.printInfo();
-      pump1.printInfo();
-      pump2.printInfo();
+      zones.printInfo();
       water_sensor.printInfo();
-      Serial.print("TIMESTAMP (s): ");
-      Serial.println(millis()/1e3);
+      Serial.print(F("TIMESTAMP (s): "));
+      Serial.println(sysclock::nowSec());
       Serial.println();
   }
+
+  //single byte commands from the serial port, a history dump goes out as the queue drains
+  void serviceCommands()
+  {
+    while(Serial.available() > 0)
+      if(Serial.read() == HISTORY_DUMP_COMMAND) history::startDump();
+    history::serviceDump();
+  }
+
+  //queues a RECORD_STATUS frame (layout in telemetry.h), sent in the background
+  //with more than ZONES_PER_STATUS zones every call carries the next chunk of them
+  //one record at a time is on the stack, telemetry::send() adds its encoding buffers on top
+  void sendTelemetry()
+  {
+    {
+      telemetry::Record record(telemetry::RECORD_STATUS);
+      record.put32(sysclock::nowSec());
+      record.put16(telemetry::dropped());
+      air_sensor.writeTelemetry(record);
+      water_sensor.writeTelemetry(record);
+      telemetryZone = zones.writeTelemetry(record, telemetryZone);
+      telemetry::send(record);
+    }
+    {
+      telemetry::Record latency(telemetry::RECORD_LATENCY);
+      profiler::writeTelemetry(latency);
+      telemetry::send(latency);
+    }
+  }
+
+  //RECORD_TRACE frames go out whenever the queue has room, a transition is sent only once it was queued
+  void serviceTrace()
+  {
+    while(pumptrace::pending() && telemetry::room(TELEMETRY_MAX_RECORD))
+    {
+      telemetry::Record trace(telemetry::RECORD_TRACE);
+      uint8_t n = pumptrace::writeTelemetry(trace);
+      if(!telemetry::send(trace)) return;
+      pumptrace::sent(n);
+    }
+  }
 }
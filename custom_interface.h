@@ -1,12 +1,21 @@
 #ifndef CUSTOM_INT_H
 #define CUSTOM_INT_H
 
+#include <stdint.h>
+
 namespace interface 
 {
   void dht11Wrapper();
   void waterSensorWrapper();
+  void restoreState();
+  void scheduleTasks();
   void readAndControl();
+  bool idle();
+  uint32_t nextDueMs();
   void printInfo();
+  void sendTelemetry();
+  void serviceCommands();
+  void serviceTrace();
 }
 
 #endif
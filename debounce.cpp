@@ -0,0 +1,62 @@
+#include <arduino.h>
+#include "debounce.h"
+
+namespace
+{
+  uint8_t mask_[fastio::PORT_COUNT];
+  uint8_t count0_[fastio::PORT_COUNT];
+  uint8_t count1_[fastio::PORT_COUNT];
+  uint8_t ticks_ = 0;
+}
+
+namespace debounce
+{
+  volatile uint8_t state[fastio::PORT_COUNT];
+
+#if defined(__AVR__)
+  //Timer0 keeps running for millis(), compare B adds an interrupt at the same rate
+  //right before the overflow, so both share one wakeup from sleep
+  void startTimer()
+  {
+    OCR0B = 0xFF;
+    TIFR0 = _BV(OCF0B);
+    TIMSK0 |= _BV(OCIE0B);
+  }
+#endif
+
+  void addPin(const fastio::Pin& pin)
+  {
+    mask_[pin.port] |= pin.mask;
+  }
+
+  void start()
+  {
+    for(uint8_t port = 0; port < fastio::PORT_COUNT; ++port)
+      if(mask_[port]) state[port] = fastio::readPort(port) & mask_[port];
+    startTimer();
+  }
+
+  void timerTick()
+  {
+    if(++ticks_ < DEBOUNCE_SAMPLE_TICKS) return;
+    ticks_ = 0;
+
+    for(uint8_t port = 0; port < fastio::PORT_COUNT; ++port)
+    {
+      if(!mask_[port]) continue;
+
+      //counters of the bits that differ from the debounced state count up, the others reset
+      uint8_t delta = (fastio::readPort(port) & mask_[port]) ^ state[port];
+      count1_[port] = (count1_[port] ^ count0_[port]) & delta;
+      count0_[port] = ~count0_[port] & delta;
+      state[port] ^= delta & ~(count0_[port] | count1_[port]);
+    }
+  }
+}
+
+#if defined(__AVR__)
+ISR(TIMER0_COMPB_vect)
+{
+  debounce::timerTick();
+}
+#endif
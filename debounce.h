@@ -0,0 +1,31 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+#include "fastio.h"
+
+const int DEBOUNCE_SAMPLE_TICKS = 12;   //Timer0 compare B every 1.024 ms - a sample every ~12 ms
+
+//debounced digital inputs, sampled from a timer interrupt
+//a 2-bit vertical counter per port filters all registered pins of the port at once:
+//a pin changes state after 4 equal samples (~50 ms), so more pins cost nothing extra
+//the Leonardo has no pin change interrupt on the switch pins (PD0, PD4), so the timer does the sampling
+namespace debounce
+{
+  extern volatile uint8_t state[fastio::PORT_COUNT];
+
+  void addPin(const fastio::Pin& pin);
+  //latches the current pin levels and starts sampling
+  void start();
+  inline bool read(const fastio::Pin& pin) { return state[pin.port] & pin.mask; }
+
+  //interrupt context
+  void timerTick();
+
+#if !defined(__AVR__)
+  //provided by the host simulation, has to call timerTick() every 1.024 ms
+  void startTimer();
+#endif
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "sysclock.h"
+#include "config.h"
+#include "et.h"
+
+namespace
+{
+  //closed hours, temperatures in half degrees
+  int8_t minHalfC_[ET_HISTORY_HOURS];
+  int8_t maxHalfC_[ET_HISTORY_HOURS];
+  uint8_t humidity_[ET_HISTORY_HOURS];
+  uint32_t valid_ = 0;      //bit per hour slot
+  static_assert(ET_HISTORY_HOURS <= 32, "one valid bit per hour");
+
+  //the hour being collected
+  bool collecting_ = false;
+  uint32_t hour_;
+  int8_t curMin_;
+  int8_t curMax_;
+  uint16_t humiditySum_;
+  uint8_t count_;
+
+  Q8_8 dailyMm_ = Q8_8::fromInt(ET_REFERENCE_MM);
+  uint8_t version_ = 0;
+
+  uint32_t isqrt(uint32_t x)
+  {
+    uint32_t root = 0;
+    for(uint32_t bit = 1UL << 30; bit; bit >>= 2)
+    {
+      if(x >= root + bit)
+      {
+        x -= root + bit;
+        root = (root >> 1) + bit;
+      }
+      else root >>= 1;
+    }
+    return root;
+  }
+
+  void estimate()
+  {
+    uint8_t n = 0;
+    int8_t t_min = 127;
+    int8_t t_max = -128;
+    uint16_t humidity_sum = 0;
+    for(uint8_t i = 0; i < ET_HISTORY_HOURS; ++i)
+    {
+      if(!(valid_ >> i & 1)) continue;
+      ++n;
+      if(minHalfC_[i] < t_min) t_min = minHalfC_[i];
+      if(maxHalfC_[i] > t_max) t_max = maxHalfC_[i];
+      humidity_sum += humidity_[i];
+    }
+
+    Q8_8 et = Q8_8::fromInt(ET_REFERENCE_MM);
+    if(n >= ET_MIN_HOURS)
+    {
+      //Q8.8 all the way, every product is shifted back before the next one
+      long mean = (long)(t_min + t_max) * 64;
+      long root = isqrt((uint32_t)(t_max - t_min) * 128 << 8);
+      long radiation = (long)ET_RADIATION_MM * (mean + 4557);    //17.8 degC
+      if(radiation < 0) radiation = 0;
+      long mm = (radiation * root >> 8) * 23 / 10000;
+
+      long factor = (100 - humidity_sum / n) * Q8_8::ONE / (100 - ET_REFERENCE_RH);
+      if(factor < ET_MIN_HUMIDITY_FACTOR.raw()) factor = ET_MIN_HUMIDITY_FACTOR.raw();
+      if(factor > ET_MAX_HUMIDITY_FACTOR.raw()) factor = ET_MAX_HUMIDITY_FACTOR.raw();
+      et = Q8_8::fromRaw(mm * factor >> 8);
+    }
+
+    if(et == dailyMm_) return;
+    dailyMm_ = et;
+    ++version_;
+  }
+
+  //hours without a good reading drop out of the day
+  void closeHour(const uint32_t next_hour)
+  {
+    uint8_t slot = hour_ % ET_HISTORY_HOURS;
+    minHalfC_[slot] = curMin_;
+    maxHalfC_[slot] = curMax_;
+    humidity_[slot] = humiditySum_ / count_;
+    valid_ |= 1UL << slot;
+
+    //the slots up to the new hour hold readings older than a day
+    if(next_hour - hour_ > (uint32_t)ET_HISTORY_HOURS) valid_ = 0;
+    else for(uint32_t h = hour_ + 1; h != next_hour + 1; ++h) valid_ &= ~(1UL << h % ET_HISTORY_HOURS);
+    estimate();
+  }
+}
+
+namespace et
+{
+  void sample(const Q8_8 temperature, const Q8_8 humidity)
+  {
+    uint32_t hour = sysclock::nowSec() / 3600;
+    int8_t half_c = temperature.raw() >> 7;
+
+    if(collecting_ && hour != hour_) closeHour(hour);
+    if(!collecting_ || hour != hour_)
+    {
+      collecting_ = true;
+      hour_ = hour;
+      curMin_ = curMax_ = half_c;
+      humiditySum_ = 0;
+      count_ = 0;
+    }
+
+    if(half_c < curMin_) curMin_ = half_c;
+    if(half_c > curMax_) curMax_ = half_c;
+    humiditySum_ += humidity.toInt();
+    ++count_;
+  }
+
+  Q8_8 dailyMm()
+  {
+    return dailyMm_;
+  }
+
+  uint8_t hours()
+  {
+    uint8_t n = 0;
+    for(uint32_t v = valid_; v; v >>= 1) n += v & 1;
+    return n;
+  }
+
+  uint8_t version()
+  {
+    return version_;
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef ET_H
+#define ET_H
+
+#include <stdint.h>
+#include "fixed.h"
+
+const int ET_HISTORY_HOURS = 24;
+const int ET_MIN_HOURS = 12;       //fewer valid hours give too small a temperature range
+constexpr Q8_8 ET_MIN_HUMIDITY_FACTOR = Q8_8::fromDouble(0.3);
+constexpr Q8_8 ET_MAX_HUMIDITY_FACTOR = Q8_8::fromDouble(1.5);
+
+//reference evapotranspiration from the DHT11 readings of the last day
+//Hargreaves: ET0 = 0.0023 * Ra * (Tmean + 17.8) * sqrt(Tmax - Tmin), Ra from config.h as there is no date,
+//scaled by the drying power of the air: (100 - RHmean) / (100 - ET_REFERENCE_RH)
+//a ring of hourly minimum, maximum and mean humidity, 3 bytes per hour
+namespace et
+{
+  //every good air reading
+  void sample(const Q8_8 temperature, const Q8_8 humidity);
+  //ET0 [mm/day], ET_REFERENCE_MM until ET_MIN_HOURS are known
+  Q8_8 dailyMm();
+  uint8_t hours();
+  //changes when the estimate does (once an hour at most)
+  uint8_t version();
+}
+
+#endif
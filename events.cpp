@@ -0,0 +1,33 @@
+#include <arduino.h>
+#include "events.h"
+
+namespace
+{
+  volatile uint8_t pending_ = 0;
+  volatile uint32_t edgeMs_[events::EVENT_COUNT];
+}
+
+namespace events
+{
+  void post(const uint8_t event)
+  {
+    edgeMs_[event] = millis();
+    pending_ |= 1 << event;
+  }
+
+  bool take(const uint8_t event, uint32_t& edge_ms)
+  {
+    if(!(pending_ & 1 << event)) return false;
+
+    noInterrupts();
+    edge_ms = edgeMs_[event];
+    pending_ &= ~(1 << event);
+    interrupts();
+    return true;
+  }
+
+  bool pending(const uint8_t event)
+  {
+    return pending_ & 1 << event;
+  }
+}
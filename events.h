@@ -0,0 +1,24 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+
+//deferred interrupt work: an ISR only posts its event (a pending bit and the time of the edge),
+//the main loop takes it and does the rest - GPIO, debouncing, state - outside of interrupt context
+//repeated edges before the event is taken collapse into one, keeping the latest edge time
+namespace events
+{
+  enum Event : uint8_t
+  {
+    WATER_LEVEL,
+    EVENT_COUNT
+  };
+
+  //interrupt context
+  void post(const uint8_t event);
+  //clears the pending bit, false when nothing was posted
+  bool take(const uint8_t event, uint32_t& edge_ms);
+  bool pending(const uint8_t event);
+}
+
+#endif
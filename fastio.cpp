@@ -0,0 +1,6 @@
+#include "fastio.h"
+
+namespace fastio
+{
+  uint8_t inputSnapshot[PORT_COUNT];
+}
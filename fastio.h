@@ -0,0 +1,137 @@
+#ifndef FASTIO_H
+#define FASTIO_H
+
+#include <stdint.h>
+
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define FASTIO_MEGA
+#endif
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#if !defined(__AVR_ATmega32U4__) && !defined(FASTIO_MEGA)
+#error "fastio pin maps are written for the ATmega32U4 (Arduino Leonardo) and the ATmega1280/2560 (Arduino Mega)"
+#endif
+#endif
+
+//direct port access for digital pins - port and bit mask are resolved from the Arduino
+//pin number once (at compile time for constant pins) instead of on every digitalRead/digitalWrite
+//pin modes are still set with pinMode(), PWM must not be used on these pins
+//the host simulation takes the Leonardo map unless it is built with the Mega MCU defined
+namespace fastio
+{
+#if defined(FASTIO_MEGA)
+  enum Port {PORT_A, PORT_B, PORT_C, PORT_D, PORT_E, PORT_F, PORT_G, PORT_H, PORT_J, PORT_K, PORT_L, PORT_COUNT};
+
+  //Arduino Mega pins 0..69
+  constexpr uint8_t PIN_PORT[] = {PORT_E, PORT_E, PORT_E, PORT_E, PORT_G, PORT_E, PORT_H, PORT_H,
+                                  PORT_H, PORT_H, PORT_B, PORT_B, PORT_B, PORT_B, PORT_J, PORT_J,
+                                  PORT_H, PORT_H, PORT_D, PORT_D, PORT_D, PORT_D, PORT_A, PORT_A,
+                                  PORT_A, PORT_A, PORT_A, PORT_A, PORT_A, PORT_A, PORT_C, PORT_C,
+                                  PORT_C, PORT_C, PORT_C, PORT_C, PORT_C, PORT_C, PORT_D, PORT_G,
+                                  PORT_G, PORT_G, PORT_L, PORT_L, PORT_L, PORT_L, PORT_L, PORT_L,
+                                  PORT_L, PORT_L, PORT_B, PORT_B, PORT_B, PORT_B, PORT_F, PORT_F,
+                                  PORT_F, PORT_F, PORT_F, PORT_F, PORT_F, PORT_F, PORT_K, PORT_K,
+                                  PORT_K, PORT_K, PORT_K, PORT_K, PORT_K, PORT_K};
+  constexpr uint8_t PIN_BIT[] =  {0, 1, 4, 5, 5, 3, 3, 4,
+                                  5, 6, 4, 5, 6, 7, 1, 0,
+                                  1, 0, 3, 2, 1, 0, 0, 1,
+                                  2, 3, 4, 5, 6, 7, 7, 6,
+                                  5, 4, 3, 2, 1, 0, 7, 2,
+                                  1, 0, 7, 6, 5, 4, 3, 2,
+                                  1, 0, 3, 2, 1, 0, 0, 1,
+                                  2, 3, 4, 5, 6, 7, 0, 1,
+                                  2, 3, 4, 5, 6, 7};
+#else
+  enum Port {PORT_B, PORT_C, PORT_D, PORT_E, PORT_F, PORT_COUNT};
+
+  //Arduino Leonardo pins 0..30
+  constexpr uint8_t PIN_PORT[] = {PORT_D, PORT_D, PORT_D, PORT_D, PORT_D, PORT_C, PORT_D, PORT_E,
+                                  PORT_B, PORT_B, PORT_B, PORT_B, PORT_D, PORT_C, PORT_B, PORT_B,
+                                  PORT_B, PORT_B, PORT_F, PORT_F, PORT_F, PORT_F, PORT_F, PORT_F,
+                                  PORT_D, PORT_D, PORT_B, PORT_B, PORT_B, PORT_D, PORT_D};
+  constexpr uint8_t PIN_BIT[] =  {2, 3, 1, 0, 4, 6, 7, 6,
+                                  4, 5, 6, 7, 6, 7, 3, 1,
+                                  2, 0, 7, 6, 5, 4, 1, 0,
+                                  4, 7, 4, 5, 6, 6, 5};
+#endif
+  static_assert(sizeof(PIN_PORT) == sizeof(PIN_BIT), "a port and a bit per pin");
+
+  struct Pin
+  {
+    uint8_t port;
+    uint8_t mask;
+    constexpr Pin() : port(0), mask(0) {}
+    constexpr Pin(const int pin) : port(PIN_PORT[pin]), mask(1 << PIN_BIT[pin]) {}
+  };
+
+#if defined(__AVR__)
+  inline uint8_t readPort(const uint8_t port)
+  {
+    switch(port)
+    {
+#if defined(FASTIO_MEGA)
+      case PORT_A: return PINA;
+      case PORT_G: return PING;
+      case PORT_H: return PINH;
+      case PORT_J: return PINJ;
+      case PORT_K: return PINK;
+      case PORT_L: return PINL;
+#endif
+      case PORT_B: return PINB;
+      case PORT_C: return PINC;
+      case PORT_D: return PIND;
+      case PORT_E: return PINE;
+      default: return PINF;
+    }
+  }
+
+  inline volatile uint8_t& outputRegister(const uint8_t port)
+  {
+    switch(port)
+    {
+#if defined(FASTIO_MEGA)
+      case PORT_A: return PORTA;
+      case PORT_G: return PORTG;
+      case PORT_H: return PORTH;
+      case PORT_J: return PORTJ;
+      case PORT_K: return PORTK;
+      case PORT_L: return PORTL;
+#endif
+      case PORT_B: return PORTB;
+      case PORT_C: return PORTC;
+      case PORT_D: return PORTD;
+      case PORT_E: return PORTE;
+      default: return PORTF;
+    }
+  }
+
+  //read-modify-write has to be atomic - the same ports are written from interrupts
+  inline void writePort(const uint8_t port, const uint8_t mask, const bool level)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    if(level) outputRegister(port) |= mask;
+    else outputRegister(port) &= ~mask;
+    SREG = sreg;
+  }
+#else
+  //provided by the host simulation
+  uint8_t readPort(const uint8_t port);
+  void writePort(const uint8_t port, const uint8_t mask, const bool level);
+#endif
+
+  extern uint8_t inputSnapshot[PORT_COUNT];
+
+  //latches all input ports at once, sensors polled in the same tick read from it
+  inline void snapshot()
+  {
+    for(uint8_t port = 0; port < PORT_COUNT; ++port) inputSnapshot[port] = readPort(port);
+  }
+
+  inline bool readSnapshot(const Pin& pin) { return inputSnapshot[pin.port] & pin.mask; }
+  inline bool read(const Pin& pin) { return readPort(pin.port) & pin.mask; }
+  inline void write(const Pin& pin, const bool level) { writePort(pin.port, pin.mask, level); }
+}
+
+#endif
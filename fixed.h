@@ -0,0 +1,72 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <arduino.h>
+#include <stdint.h>
+
+//binary fixed-point number with FRAC_BITS fractional bits stored in Raw
+//replaces float/double in the control paths - the AVR has no FPU
+template<int FRAC_BITS, typename Raw>
+class Fixed
+{
+  private:
+    Raw raw_;
+    constexpr Fixed(const Raw raw, bool) : raw_(raw) {}
+  public:
+    static const long ONE = 1L << FRAC_BITS;
+
+    constexpr Fixed() : raw_(0) {}
+    static constexpr Fixed fromRaw(const long raw) { return Fixed((Raw)raw, true); }
+    static constexpr Fixed fromInt(const long n) { return Fixed((Raw)(n * ONE), true); }
+    //for constants only, evaluated by the compiler
+    static constexpr Fixed fromDouble(const double d) { return Fixed((Raw)(d < 0 ? d * ONE - 0.5 : d * ONE + 0.5), true); }
+
+    constexpr Raw raw() const { return raw_; }
+    constexpr long toInt() const { return raw_ >> FRAC_BITS; }
+    template<class To> constexpr To convert() const
+    {
+      return To::fromRaw( FRAC_BITS > To::FRAC ? (long)raw_ >> (FRAC_BITS - To::FRAC) : (long)raw_ << (To::FRAC - FRAC_BITS) );
+    }
+
+    static const int FRAC = FRAC_BITS;
+
+    constexpr Fixed operator+(const Fixed other) const { return Fixed(raw_ + other.raw_, true); }
+    constexpr Fixed operator-(const Fixed other) const { return Fixed(raw_ - other.raw_, true); }
+    constexpr Fixed operator*(const long n) const { return Fixed(raw_ * n, true); }
+    constexpr bool operator<(const Fixed other) const { return raw_ < other.raw_; }
+    constexpr bool operator>(const Fixed other) const { return raw_ > other.raw_; }
+    constexpr bool operator<=(const Fixed other) const { return raw_ <= other.raw_; }
+    constexpr bool operator>=(const Fixed other) const { return raw_ >= other.raw_; }
+    constexpr bool operator==(const Fixed other) const { return raw_ == other.raw_; }
+    constexpr bool operator!=(const Fixed other) const { return raw_ != other.raw_; }
+};
+
+typedef Fixed<8, int16_t> Q8_8;     //temperature, humidity, dew point
+typedef Fixed<8, int32_t> Q24_8;    //water volume in litres
+typedef Fixed<16, int32_t> Q16_16;  //water flow in litres per second
+
+//decimal printing without the float formatting code
+template<int FRAC_BITS, typename Raw>
+void printFixed(const Fixed<FRAC_BITS, Raw> value, const int digits)
+{
+  unsigned long scale = 1;
+  for(int i = 0; i < digits; ++i) scale *= 10;
+
+  long raw = value.raw();
+  if(raw < 0)
+  {
+    Serial.print('-');
+    raw = -raw;
+  }
+
+  unsigned long scaled = ((unsigned long)raw * scale + (1UL << (FRAC_BITS - 1))) >> FRAC_BITS;
+  Serial.print(scaled / scale);
+  if(!digits) return;
+
+  Serial.print('.');
+  unsigned long fraction = scaled % scale;
+  for(unsigned long d = scale / 10; d > 1 && fraction < d; d /= 10) Serial.print('0');
+  Serial.print(fraction);
+}
+
+#endif
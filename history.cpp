@@ -0,0 +1,223 @@
+#include "sysclock.h"
+#include "history.h"
+
+namespace
+{
+  const uint16_t NO_RUN = 0xFFFF;
+  const int HEADER_SIZE = 15;
+  const uint8_t RUN = 0x80;
+  const uint8_t TOGGLE = 0x40;
+  const uint8_t HAS_HUMIDITY = 1;
+  const uint8_t HAS_FLAGS = 2;
+  const uint8_t TEMPERATURE_SHIFT = 2;
+  const uint8_t TEMPERATURE_FOLLOWS = 15;   //4 bit zig-zag delta, 15 - a varint follows
+
+  uint8_t ring_[HISTORY_BYTES];
+  uint16_t tail_ = 0;        //oldest record
+  uint16_t used_ = 0;
+  uint16_t lastRun_ = NO_RUN;
+  uint16_t samples_ = 0;
+
+  //the oldest sample and the newest one
+  int8_t baseTemperature_;
+  uint8_t baseHumidity_;
+  uint32_t baseFlags_;
+  int8_t temperature_;
+  uint8_t humidity_;
+  uint32_t flags_;
+  uint32_t sampleSec_;
+
+  uint16_t pumpsRan_ = 0;
+
+  //dump in progress: stream offset, the header is taken when it starts
+  bool dumping_ = false;
+  uint16_t dumpOffset_;
+  uint8_t dumpHeader_[HEADER_SIZE];
+
+  uint8_t at(const uint16_t offset)
+  {
+    return ring_[(tail_ + offset) % HISTORY_BYTES];
+  }
+
+  uint32_t getVarint(uint16_t& offset)
+  {
+    uint32_t value = 0;
+    for(uint8_t shift = 0; ; shift += 7)
+    {
+      uint8_t b = at(offset++);
+      value |= (uint32_t)(b & 0x7F) << shift;
+      if(!(b & 0x80)) return value;
+    }
+  }
+
+  uint8_t putVarint(uint8_t* out, uint32_t value)
+  {
+    uint8_t n = 0;
+    for(; value >= 0x80; value >>= 7) out[n++] = value | 0x80;
+    out[n++] = value;
+    return n;
+  }
+
+  uint32_t zigzag(const int16_t delta)
+  {
+    return (uint16_t)(delta << 1) ^ (uint16_t)(delta >> 15);
+  }
+
+  int16_t unzigzag(const uint32_t value)
+  {
+    return (int16_t)(value >> 1) ^ -(int16_t)(value & 1);
+  }
+
+  //folds the oldest record into the base sample
+  void evict()
+  {
+    uint16_t offset = 0;
+    uint8_t header = at(offset++);
+    if(header & RUN) samples_ -= (header & 0x7F) + 1;
+    else if(header & TOGGLE)
+    {
+      baseFlags_ ^= 1UL << (header & 0x1F);
+      --samples_;
+    }
+    else
+    {
+      uint8_t t = header >> TEMPERATURE_SHIFT;
+      baseTemperature_ += unzigzag(t == TEMPERATURE_FOLLOWS ? getVarint(offset) : t);
+      if(header & HAS_HUMIDITY) baseHumidity_ += unzigzag(getVarint(offset));
+      if(header & HAS_FLAGS) baseFlags_ ^= getVarint(offset);
+      --samples_;
+    }
+    if(lastRun_ == tail_) lastRun_ = NO_RUN;
+    tail_ = (tail_ + offset) % HISTORY_BYTES;
+    used_ -= offset;
+  }
+
+  void append(const uint8_t* record, const uint8_t size)
+  {
+    while(HISTORY_BYTES - used_ < size) evict();
+    for(uint8_t i = 0; i < size; ++i) ring_[(tail_ + used_ + i) % HISTORY_BYTES] = record[i];
+    used_ += size;
+  }
+
+  void putHeader(uint8_t* out)
+  {
+    uint32_t values[] = {sampleSec_, HISTORY_SAMPLE_SEC, samples_};
+    const uint8_t sizes[] = {4, 2, 2};
+    for(uint8_t v = 0; v < 3; ++v)
+      for(uint8_t i = 0; i < sizes[v]; ++i, values[v] >>= 8) *out++ = values[v];
+    *out++ = ZONE_COUNT;
+    *out++ = baseTemperature_;
+    *out++ = baseHumidity_;
+    for(uint8_t i = 0; i < 4; ++i) *out++ = baseFlags_ >> 8 * i;
+  }
+}
+
+namespace history
+{
+  void sample(const Q8_8 temperature, const Q8_8 humidity, const uint32_t flags_now)
+  {
+    uint32_t flags = flags_now | (uint32_t)pumpsRan_ << HISTORY_PUMPS_SHIFT;
+    bool air_error = flags & 2 && samples_;
+    int8_t t = air_error ? temperature_ : temperature.raw() >> 7;
+    uint8_t h = air_error ? humidity_ : humidity.toInt();
+    pumpsRan_ = 0;
+    sampleSec_ = sysclock::nowSec();
+    //the count is 16 bit, long runs of quiet samples could pass it
+    while(samples_ == 0xFFFF && used_) evict();
+
+    if(!samples_)
+    {
+      baseTemperature_ = temperature_ = t;
+      baseHumidity_ = humidity_ = h;
+      baseFlags_ = flags_ = flags;
+      samples_ = 1;
+      return;
+    }
+
+    uint8_t record[1 + 3 + 3 + 5];
+    uint8_t size = 1;
+    uint32_t toggled = flags ^ flags_;
+    uint32_t dt = zigzag(t - temperature_);
+    if(!dt && h == humidity_ && toggled && !(toggled & (toggled - 1)))
+    {
+      //a single flag, usually a pump starting or stopping
+      uint8_t bit = 0;
+      while(toggled >> bit != 1) ++bit;
+      record[0] = TOGGLE | bit;
+    }
+    else
+    {
+      record[0] = (dt < TEMPERATURE_FOLLOWS ? dt : TEMPERATURE_FOLLOWS) << TEMPERATURE_SHIFT;
+      if(dt >= TEMPERATURE_FOLLOWS) size += putVarint(record + size, dt);
+      if(h != humidity_)
+      {
+        record[0] |= HAS_HUMIDITY;
+        size += putVarint(record + size, zigzag(h - humidity_));
+      }
+      if(toggled)
+      {
+        record[0] |= HAS_FLAGS;
+        size += putVarint(record + size, toggled);
+      }
+    }
+    temperature_ = t;
+    humidity_ = h;
+    flags_ = flags;
+
+    //an unchanged sample lengthens the run at the end of the ring
+    if(!record[0] && lastRun_ != NO_RUN && ring_[lastRun_] != 0xFF)
+    {
+      ++ring_[lastRun_];
+      ++samples_;
+      return;
+    }
+
+    if(!record[0]) record[0] = RUN;
+    append(record, size);
+    lastRun_ = record[0] == RUN ? (tail_ + used_ - 1) % HISTORY_BYTES : NO_RUN;
+    ++samples_;
+  }
+
+  void notePumps(const uint16_t running)
+  {
+    pumpsRan_ |= running;
+  }
+
+  uint16_t samples()
+  {
+    return samples_;
+  }
+
+  uint16_t bytes()
+  {
+    return used_;
+  }
+
+  void startDump()
+  {
+    if(dumping_) return;
+    dumping_ = true;
+    dumpOffset_ = 0;
+    putHeader(dumpHeader_);
+  }
+
+  bool dumping()
+  {
+    return dumping_;
+  }
+
+  void serviceDump()
+  {
+    uint16_t total = HEADER_SIZE + used_;
+    while(dumping_ && telemetry::room(TELEMETRY_MAX_RECORD))
+    {
+      telemetry::Record record(telemetry::RECORD_HISTORY);
+      record.put16(dumpOffset_);
+      record.put16(total);
+      for(uint8_t i = 0; i < HISTORY_CHUNK && dumpOffset_ < total; ++i, ++dumpOffset_)
+        record.put8(dumpOffset_ < HEADER_SIZE ? dumpHeader_[dumpOffset_] : at(dumpOffset_ - HEADER_SIZE));
+      telemetry::send(record);
+      dumping_ = dumpOffset_ < total;
+    }
+  }
+}
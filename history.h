@@ -0,0 +1,55 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include "config.h"
+#include "fixed.h"
+#include "telemetry.h"
+
+const unsigned long HISTORY_SAMPLE_SEC = 600;
+//SRAM budget of the ATmega32U4 (2560 bytes), estimated from the type sizes - there is no AVR size report in this tree:
+//globals about 2 KB with this ring (profiler 306, trace 144, telemetry queue 128, zones ~115, EEPROM buffer 32,
+//sensors, scheduler and the Arduino core ~250), the printed texts stay in flash (F()), the deepest stack about 300 bytes -
+//a Record and the telemetry::send() buffers under loop() plus an ISR, some 250 bytes stay free
+//960 bytes keep 8 to 9 days of samples (sim --season), check avr-size and the stack before taking more
+const int HISTORY_BYTES = 960;
+const unsigned long HISTORY_DUMP_WAIT_MS = 100;
+const uint8_t HISTORY_DUMP_COMMAND = 'h';
+const int HISTORY_CHUNK = TELEMETRY_MAX_RECORD - 5;
+
+//sample flags: bit0 tank ok, bit1 air sensor error, then a ZONE_COUNT bit mask each of
+//pumps that ran since the previous sample, soil probe 1 dry and soil probe 2 dry
+const int HISTORY_PUMPS_SHIFT = 2;
+const int HISTORY_PROBE1_SHIFT = HISTORY_PUMPS_SHIFT + ZONE_COUNT;
+const int HISTORY_PROBE2_SHIFT = HISTORY_PROBE1_SHIFT + ZONE_COUNT;
+static_assert(HISTORY_PROBE2_SHIFT + ZONE_COUNT <= 32, "history flags hold up to 10 zones");
+
+//sensor history in a RAM ring, one sample every HISTORY_SAMPLE_SEC, lost on a reset
+//samples are kept as changes against the previous one, the oldest are dropped when the ring is full:
+//  1nnnnnnn                  n+1 samples equal to the previous one
+//  010bbbbb                  flag bit b toggled, nothing else changed
+//  00ttttfh, then in order   tttt: zig-zag temperature delta [0.5 degC], 15 - the delta follows as a zig-zag varint
+//                            h: humidity delta [%] - zig-zag varint, f: flags XOR the previous flags - varint
+//the values of the oldest sample are kept outside of the ring, an evicted record is folded into them
+//a quiet day takes a few bytes, a pump start or stop one, a change of the weather mostly two
+//
+//the dump (HISTORY_DUMP_COMMAND over serial) streams RECORD_HISTORY frames of the stream:
+//  u32 timestamp of the newest sample [s], u16 sample period [s], u16 sample count, u8 zone count,
+//  i8 temperature [0.5 degC], u8 humidity [%], u32 flags of the oldest sample, then the ring records
+namespace history
+{
+  //readings of a failed air sensor are not stored, the previous ones are repeated
+  void sample(const Q8_8 temperature, const Q8_8 humidity, const uint32_t flags);
+  //pumps running now, called every control tick so that short runs between samples are seen
+  void notePumps(const uint16_t running);
+  uint16_t samples();
+  uint16_t bytes();
+
+  //a new sample waits while a dump is in progress
+  void startDump();
+  bool dumping();
+  //queues the next chunks while the telemetry queue has room
+  void serviceDump();
+}
+
+#endif
@@ -0,0 +1,53 @@
+#if defined(__AVR__)
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include "hwtimer.h"
+
+namespace
+{
+  void (*volatile callback_)() = nullptr;
+  const unsigned long US_PER_TICK = 64 / clockCyclesPerMicrosecond();
+}
+
+namespace hwtimer
+{
+  //CTC mode with prescaler 64 - 4 us resolution and up to ~262 ms at 16 MHz
+  void startOneShot(unsigned long us, void (*callback)())
+  {
+    unsigned long ticks = us / US_PER_TICK;
+    if(ticks > 0xFFFF) ticks = 0xFFFF;
+    if(!ticks) ticks = 1;
+
+    uint8_t sreg = SREG;
+    cli();
+    callback_ = callback;
+    TCCR3B = 0;
+    TCCR3A = 0;
+    TCNT3 = 0;
+    OCR3A = ticks;
+    TIFR3 = _BV(OCF3A);
+    TIMSK3 = _BV(OCIE3A);
+    TCCR3B = _BV(WGM32) | _BV(CS31) | _BV(CS30);
+    SREG = sreg;
+  }
+
+  void cancel()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    TCCR3B = 0;
+    TIMSK3 = 0;
+    callback_ = nullptr;
+    SREG = sreg;
+  }
+}
+
+ISR(TIMER3_COMPA_vect)
+{
+  void (*callback)() = callback_;
+  hwtimer::cancel();
+  if(callback) callback();
+}
+
+#endif
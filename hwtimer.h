@@ -0,0 +1,12 @@
+#ifndef HWTIMER_H
+#define HWTIMER_H
+
+//one-shot hardware timer (Timer3 on the ATmega32U4)
+//the callback runs in interrupt context, so it has to be short
+namespace hwtimer
+{
+  void startOneShot(unsigned long us, void (*callback)());
+  void cancel();
+}
+
+#endif
@@ -9,8 +9,43 @@
 */
 
 #include "idDHT11.h"
+#include "hwtimer.h"
 #define DEBUG_IDDHT11
 
+idDHT11* volatile idDHT11::startSignalOwner = NULL;
+
+// compile time only helpers for the dew point tables, nothing here ends up in the image
+// ln(x) for 0 < x <= 1: halving range reduction, then the atanh series for x in [0.5, 1]
+static constexpr double lnSeries(double z, double z2, int k) {
+	return k > 41 ? 0 : z / k + lnSeries(z * z2, z2, k + 2);
+}
+static constexpr double lnReduced(double z) {
+	return 2 * lnSeries(z, z * z, 1);
+}
+static constexpr double ln(double x) {
+	return x < 0.5 ? ln(2 * x) - 0.69314718055994531 : lnReduced((x - 1) / (x + 1));
+}
+static constexpr int16_t q12(double v) {
+	return (int16_t)(v < 0 ? v * 4096 - 0.5 : v * 4096 + 0.5);
+}
+
+// Magnus formula split into a temperature and a humidity term, in 1/4096:
+// g = a*T/(b+T) + ln(RH/100), Td = b*g/(a-g)
+#define DP_T(t)		q12(17.271 * (t) / (237.7 + (t)))
+#define DP_T8(t)	DP_T(t), DP_T(t+1), DP_T(t+2), DP_T(t+3), DP_T(t+4), DP_T(t+5), DP_T(t+6), DP_T(t+7)
+#define DP_H(h)		q12(ln(((h) ? (h) : 1) / 100.0))
+#define DP_H10(h)	DP_H(h), DP_H(h+1), DP_H(h+2), DP_H(h+3), DP_H(h+4), DP_H(h+5), DP_H(h+6), DP_H(h+7), DP_H(h+8), DP_H(h+9)
+
+static constexpr int16_t DEWPOINT_TEMP_TERM[64] PROGMEM = {
+	DP_T8(0), DP_T8(8), DP_T8(16), DP_T8(24), DP_T8(32), DP_T8(40), DP_T8(48), DP_T8(56)
+};
+static constexpr int16_t DEWPOINT_HUM_TERM[101] PROGMEM = {
+	DP_H10(0), DP_H10(10), DP_H10(20), DP_H10(30), DP_H10(40),
+	DP_H10(50), DP_H10(60), DP_H10(70), DP_H10(80), DP_H10(90), DP_H(100)
+};
+#define DP_A_Q12	70742L		// 17.271 * 4096
+#define DP_B_Q8		60851L		// 237.7 * 256
+
 idDHT11::idDHT11(int pin, int intNumber,void (*callback_wrapper)()) {
 	init(pin, intNumber,callback_wrapper);
 }
@@ -27,11 +62,13 @@ void idDHT11::init(int pin, int intNumber, void (*callback_wrapper) ()) {
 	status = IDDHTLIB_ERROR_NOTSTARTED;
 }
 
+// non-blocking: the 18 ms start signal is timed by a hardware timer and the
+// response is decoded in isrCallback(), poll acquiring() for the result
 int idDHT11::acquire() {
 	if (state == STOPPED || state == ACQUIRED) {
 		
-		//set the state machine for interruptions analisis of the signal
-		state = RESPONSE;
+		//start signal in progress
+		state = ACQUIRING;
 		
 		// EMPTY BUFFER and vars
 		for (int i=0; i< 5; i++) bits[i] = 0;
@@ -43,23 +80,36 @@ int idDHT11::acquire() {
 		// REQUEST SAMPLE
 		pinMode(pin, OUTPUT);
 		digitalWrite(pin, LOW);
-		delay(18);
-		digitalWrite(pin, HIGH);
-		delayMicroseconds(40);
-		pinMode(pin, INPUT);
-		
-		// Analize the data in an interrupt
-		us = micros();
-		attachInterrupt(intNumber,isrCallback_wrapper,FALLING);
+		startSignalOwner = this;
+		hwtimer::startOneShot(18000, startSignalDone);
 		
 		return IDDHTLIB_ACQUIRING;
 	} else
 		return IDDHTLIB_ERROR_ACQUIRING;
 }
+// timer interrupt context
+void idDHT11::startSignalDone() {
+	idDHT11* owner = startSignalOwner;
+	startSignalOwner = NULL;
+	if (owner)
+		owner->releaseBus();
+}
+void idDHT11::releaseBus() {
+	digitalWrite(pin, HIGH);
+	delayMicroseconds(40);
+	pinMode(pin, INPUT);
+	
+	//set the state machine for interruptions analisis of the signal
+	state = RESPONSE;
+	
+	// Analize the data in an interrupt
+	us = micros();
+	attachInterrupt(intNumber,isrCallback_wrapper,FALLING);
+}
 int idDHT11::acquireAndWait() {
 	acquire();
 	while(acquiring())
-		;
+		yield();
 	return getStatus();
 }
 void idDHT11::isrCallback() {
@@ -123,6 +173,17 @@ void idDHT11::isrCallback() {
 	}
 }
 bool idDHT11::acquiring() {
+	if (state == RESPONSE || state == DATA) {
+		// the ISR only notices a timeout on the next edge, a silent sensor has to be caught here
+		noInterrupts();
+		int delta = (int)micros() - us;
+		if ((state == RESPONSE || state == DATA) && delta > 6000) {
+			detachInterrupt(intNumber);
+			status = IDDHTLIB_ERROR_ISR_TIMEOUT;
+			state = STOPPED;
+		}
+		interrupts();
+	}
 	if (state != ACQUIRED && state != STOPPED)
 		return true;
 	return false;
@@ -140,6 +201,16 @@ float idDHT11::getHumidity() {
 	return hum;
 }
 
+int16_t idDHT11::getCelsiusFixed() {
+	IDDHT11_CHECK_STATE;
+	return (int16_t)bits[2] << IDDHT11_FRAC_BITS;
+}
+
+int16_t idDHT11::getHumidityFixed() {
+	IDDHT11_CHECK_STATE;
+	return (int16_t)bits[0] << IDDHT11_FRAC_BITS;
+}
+
 float idDHT11::getFahrenheit() {
 	IDDHT11_CHECK_STATE;
 	return temp * 1.8 + 32;
@@ -162,6 +233,18 @@ double idDHT11::getDewPoint() {
 	return Td;
 	
 }
+// same formula as getDewPoint() from two PROGMEM tables and a single integer division,
+// DHT11 reports whole degrees and percents so no interpolation is needed
+// result in 1/(2^IDDHT11_FRAC_BITS) degC
+int16_t idDHT11::getDewPointFixed() {
+	IDDHT11_CHECK_STATE;
+	uint8_t t = bits[2] < 64 ? bits[2] : 63;
+	uint8_t h = bits[0] <= 100 ? bits[0] : 100;
+	int32_t g = (int16_t)pgm_read_word(&DEWPOINT_TEMP_TERM[t]) + (int16_t)pgm_read_word(&DEWPOINT_HUM_TERM[h]);
+	int32_t num = g * DP_B_Q8;
+	int32_t den = DP_A_Q12 - g;
+	return (num + (num < 0 ? -den : den) / 2) / den;
+}
 // dewPoint function NOAA
 // reference: http://wahiduddin.net/calc/density_algorithms.htm 
 double idDHT11::getDewPointSlow() {
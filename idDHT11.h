@@ -35,6 +35,9 @@
 #define IDDHTLIB_ERROR_DELTA		-6
 #define IDDHTLIB_ERROR_NOTSTARTED	-7
 
+// fixed point getters return 1/256 units
+#define IDDHT11_FRAC_BITS		8
+
 #define IDDHT11_CHECK_STATE		if(state == STOPPED)													\
 									return status;													\
 								else if(state != ACQUIRED)				\
@@ -53,6 +56,9 @@ public:
 	float getKelvin();
 	double getDewPoint();
 	double getDewPointSlow();
+	int16_t getDewPointFixed();
+	int16_t getCelsiusFixed();
+	int16_t getHumidityFixed();
 	float getHumidity();
 	bool acquiring();
 	int getStatus();
@@ -60,6 +66,9 @@ public:
 private:
 	
 	void (*isrCallback_wrapper)(void);
+	void releaseBus();
+	static void startSignalDone();
+	static idDHT11* volatile startSignalOwner;
 	
 	enum states{RESPONSE=0,DATA=1,ACQUIRED=2,STOPPED=3,ACQUIRING=4};
 	volatile states state;
@@ -0,0 +1,125 @@
+#include <arduino.h>
+#include "sysclock.h"
+#include "telemetry.h"
+#include "persist.h"
+
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
+
+namespace
+{
+  uint8_t buffer_[PERSIST_SLOT_SIZE];
+  uint8_t bufferSize_ = 0;
+  uint8_t written_ = 0;
+  int slotAddress_ = 0;
+  uint16_t sequence_ = 0;
+  uint8_t slot_ = PERSIST_SLOTS - 1;
+  bool dirty_ = false;
+  bool urgent_ = false;
+  uint32_t lastSaveSec_ = 0;
+}
+
+namespace persist
+{
+#if defined(__AVR__)
+  uint8_t readByte(const int address) { return eeprom_read_byte((const uint8_t*)address); }
+  bool writeReady() { return eeprom_is_ready(); }
+  void writeByte(const int address, const uint8_t value) { eeprom_write_byte((uint8_t*)address, value); }
+#endif
+
+  bool load(Record& record, const uint8_t size)
+  {
+    bool found = false;
+    uint8_t slot_data[PERSIST_SLOT_SIZE];
+
+    if(size > PERSIST_MAX_PAYLOAD) return false;
+
+    for(uint8_t slot = 0; slot < PERSIST_SLOTS; ++slot)
+    {
+      int address = slot * PERSIST_SLOT_SIZE;
+      if(readByte(address + 2) != size) continue;
+
+      for(uint8_t i = 0; i < size + 5; ++i) slot_data[i] = readByte(address + i);
+      if(telemetry::crc16(slot_data, size + 3) != (slot_data[size + 3] | slot_data[size + 4] << 8)) continue;
+
+      uint16_t sequence = slot_data[0] | slot_data[1] << 8;
+      if(found && (int16_t)(sequence - sequence_) <= 0) continue;
+
+      found = true;
+      sequence_ = sequence;
+      slot_ = slot;
+      memcpy(record.data(), slot_data + 3, size);
+    }
+
+    if(found) record.setSize(size);
+    return found;
+  }
+
+  void touch(const bool urgent)
+  {
+    dirty_ = true;
+    urgent_ |= urgent;
+  }
+
+  bool saveDue()
+  {
+    if(busy()) return false;
+
+    uint32_t since_save_sec = sysclock::elapsedSec(lastSaveSec_);
+    if(!dirty_) return since_save_sec >= PERSIST_REFRESH_SEC;
+    return since_save_sec >= (urgent_ ? PERSIST_URGENT_SEC : PERSIST_LAZY_SEC);
+  }
+
+  void save(const Record& record)
+  {
+    uint8_t size = record.size();
+
+    ++sequence_;
+    slot_ = (slot_ + 1) % PERSIST_SLOTS;
+    slotAddress_ = slot_ * PERSIST_SLOT_SIZE;
+
+    buffer_[0] = sequence_;
+    buffer_[1] = sequence_ >> 8;
+    buffer_[2] = size;
+    memcpy(buffer_ + 3, record.data(), size);
+    uint16_t crc = telemetry::crc16(buffer_, size + 3);
+    buffer_[size + 3] = crc;
+    buffer_[size + 4] = crc >> 8;
+
+    bufferSize_ = size + 5;
+    written_ = 0;
+    dirty_ = false;
+    urgent_ = false;
+    lastSaveSec_ = sysclock::nowSec();
+  }
+
+  bool busy()
+  {
+    return written_ < bufferSize_;
+  }
+
+  //a second boundary of nowSec() comes up to 1 s early, that second is left out
+  unsigned long quietMs()
+  {
+    if(busy()) return 0;
+
+    uint32_t since_save_sec = sysclock::elapsedSec(lastSaveSec_);
+    unsigned long due_sec = !dirty_ ? PERSIST_REFRESH_SEC : urgent_ ? PERSIST_URGENT_SEC : PERSIST_LAZY_SEC;
+    return since_save_sec + 1 < due_sec ? (due_sec - since_save_sec - 1) * 1000 : 0;
+  }
+
+  unsigned long service()
+  {
+    if(!busy()) return PERSIST_IDLE_MS;
+    if(!writeReady()) return PERSIST_WRITE_MS;
+
+    //bytes that already hold the right value are skipped, they cost no wear
+    while(busy() && readByte(slotAddress_ + written_) == buffer_[written_]) ++written_;
+    if(!busy()) return PERSIST_IDLE_MS;
+
+    writeByte(slotAddress_ + written_, buffer_[written_]);
+    ++written_;
+    return PERSIST_WRITE_MS;
+  }
+}
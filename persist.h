@@ -0,0 +1,69 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdint.h>
+#include "config.h"
+
+//a slot holds the state of all zones (SystemZones::STATE_SIZE - 4 bytes and 13 per soil driven or 9 per timer
+//driven zone) and is rounded up to 16 bytes, the EEPROM of the board takes as many slots as fit
+const int PERSIST_EEPROM_SIZE = E2END + 1;
+const int PERSIST_MAX_PAYLOAD = 4 + ZONE_COUNT * (PUMP_CONTROL == SOIL_DRIVEN ? 13 : 9);
+const int PERSIST_SLOT_SIZE = (PERSIST_MAX_PAYLOAD + 5 + 15) / 16 * 16;
+const int PERSIST_SLOTS = PERSIST_EEPROM_SIZE / PERSIST_SLOT_SIZE;
+static_assert(PERSIST_MAX_PAYLOAD <= 0xFF, "the slot stores the payload size in a byte");
+static_assert(PERSIST_SLOTS >= 2, "the journal needs two slots to survive a torn write");
+const unsigned long PERSIST_URGENT_SEC = 60;     //pump state changes
+const unsigned long PERSIST_LAZY_SEC = 900;      //counters
+const unsigned long PERSIST_REFRESH_SEC = 3600;  //stored ages of the pump times keep up
+const unsigned long PERSIST_IDLE_MS = 1000;
+const unsigned long PERSIST_WRITE_MS = 4;        //one byte takes 3.4 ms
+
+//journal of state records in EEPROM, every save goes to the next slot (wear levelling)
+//slot: u16 sequence, u8 payload size, payload, u16 CRC-16/CCITT over all of it
+//a torn write fails the CRC, so load() falls back to the previous record
+//saves are copied to RAM and written one byte per service() call - nothing waits for the EEPROM
+namespace persist
+{
+  class Record
+  {
+    private:
+      uint8_t data_[PERSIST_MAX_PAYLOAD];
+      uint8_t size_;
+      uint8_t pos_;
+    public:
+      Record() : size_(0), pos_(0) {}
+      void put8(const uint8_t value) { if(size_ < PERSIST_MAX_PAYLOAD) data_[size_++] = value; }
+      void put16(const uint16_t value) { put8(value); put8(value >> 8); }
+      void put32(const uint32_t value) { put16(value); put16(value >> 16); }
+      uint8_t get8() { return pos_ < size_ ? data_[pos_++] : 0; }
+      uint16_t get16() { uint16_t low = get8(); return low | (uint16_t)get8() << 8; }
+      uint32_t get32() { uint32_t low = get16(); return low | (uint32_t)get16() << 16; }
+      uint8_t* data() { return data_; }
+      const uint8_t* data() const { return data_; }
+      uint8_t size() const { return size_; }
+      void setSize(const uint8_t size) { size_ = size; pos_ = 0; }
+  };
+
+  //newest valid record of the given size, false on a blank or incompatible EEPROM
+  bool load(Record& record, const uint8_t size);
+
+  //something worth saving changed, urgent changes are written sooner
+  void touch(const bool urgent);
+  bool saveDue();
+  //starts writing the record into the next slot
+  void save(const Record& record);
+  bool busy();
+  //writes at most one byte, returns ms until it wants to run again
+  unsigned long service();
+  //ms until the next save is due, 0 while one is being written
+  unsigned long quietMs();
+
+#if !defined(__AVR__)
+  //provided by the host simulation
+  uint8_t readByte(const int address);
+  bool writeReady();
+  void writeByte(const int address, const uint8_t value);
+#endif
+}
+
+#endif
@@ -0,0 +1,32 @@
+#include <arduino.h>
+#include "power.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#include <avr/power.h>
+#endif
+
+namespace power
+{
+  void start()
+  {
+#if defined(__AVR__)
+    power_spi_disable();
+    power_twi_disable();
+    power_usart1_disable();
+    power_timer4_disable();
+    set_sleep_mode(SLEEP_MODE_IDLE);
+#endif
+  }
+
+  void sleep()
+  {
+#if defined(__AVR__)
+    sleep_enable();
+    sleep_cpu();
+    sleep_disable();
+#else
+    waitForInterrupt();
+#endif
+  }
+}
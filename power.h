@@ -0,0 +1,29 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+//the loop sleeps in idle mode whenever it has nothing left to do
+//every interrupt wakes it: Timer0 (millis and the switch debounce, every 1.024 ms), Timer3 (DHT11 start signal),
+//INT1 (water sensor), INT6 (DHT11 data), the ADC and USB
+//the switches have no interrupt of their own, a press is noticed by the debounce on the Timer0 wakeup
+//power-down would stop Timer0 and the USB link the telemetry goes over, so idle is the deepest mode used
+//
+//idle current measurement: power the board through VIN from a bench supply with a 1 ohm shunt
+//in the supply line, USB data only (5V wire cut in the cable); relays and buzzer off, DHT11 connected.
+//read the shunt with a scope at >= 10 kS/s over 10 s and average, with SLEEP_WHEN_IDLE 1 and 0
+namespace power
+{
+  //disables the clocks of the unused peripherals (SPI, TWI, USART1, Timer4)
+  void start();
+  //sleeps until the next interrupt - a wakeup missed between the idle check and the sleep
+  //costs at most one Timer0 period
+  void sleep();
+
+#if !defined(__AVR__)
+  //provided by the host simulation, moves virtual time to the next interrupt
+  void waitForInterrupt();
+#endif
+}
+
+#endif
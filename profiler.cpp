@@ -0,0 +1,66 @@
+#include <arduino.h>
+#include "profiler.h"
+
+namespace
+{
+  profiler::Stage stages_[PROFILER_STAGES];
+  uint8_t nextReported_ = 0;
+
+  void clear(profiler::Stage& s)
+  {
+    memset(&s, 0, sizeof(s));
+    s.min = 0xFFFF;
+  }
+}
+
+namespace profiler
+{
+  void start()
+  {
+#if defined(__AVR__)
+    TCCR1A = 0;
+    TCCR1B = _BV(CS11);
+    TIMSK1 = 0;
+#endif
+    for(uint8_t i = 0; i < PROFILER_STAGES; ++i) clear(stages_[i]);
+  }
+
+  void record(const uint8_t stage, const uint16_t duration)
+  {
+    if(stage >= PROFILER_STAGES) return;
+
+    Stage& s = stages_[stage];
+    uint8_t bucket = 0;
+    for(uint16_t d = duration >> 1; d && bucket < PROFILER_BUCKETS - 1; d >>= 1) ++bucket;
+
+    if(s.count == 0xFFFF) return;
+    ++s.count;
+    s.sum += duration;
+    if(duration < s.min) s.min = duration;
+    if(duration > s.max) s.max = duration;
+    ++s.histogram[bucket];
+  }
+
+  const Stage& stage(const uint8_t stage)
+  {
+    return stages_[stage < PROFILER_STAGES ? stage : PROFILER_TICK_STAGE];
+  }
+
+  //task slots that never ran (not registered, or idle for the whole window) are skipped
+  void writeTelemetry(telemetry::Record& record)
+  {
+    for(uint8_t i = 0; i < PROFILER_TICK_STAGE && !stages_[nextReported_].count; ++i)
+      nextReported_ = (nextReported_ + 1) % PROFILER_STAGES;
+    Stage& s = stages_[nextReported_];
+
+    record.put8(nextReported_);
+    record.put16(s.count);
+    record.put16(s.count ? s.min : 0);
+    record.put16(s.max);
+    record.put16(s.count ? s.sum / s.count : 0);
+    for(uint8_t i = 0; i < PROFILER_BUCKETS; ++i) record.put16(s.histogram[i]);
+
+    clear(s);
+    nextReported_ = (nextReported_ + 1) % PROFILER_STAGES;
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "telemetry.h"
+#include "scheduler.h"
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#endif
+
+//stages: a slot per scheduler task in registration order, then a whole scheduler tick
+const int PROFILER_TICK_STAGE = MAX_TASKS;
+const int PROFILER_STAGES = PROFILER_TICK_STAGE + 1;
+const int PROFILER_BUCKETS = 12;
+
+//execution time of every stage in Timer1 ticks (prescaler 8 - 0.5 us at 16 MHz, wraps after 32 ms)
+//statistics cover the window since the stage was last reported over telemetry
+//histogram bucket i counts durations in [2^i, 2^(i+1)) ticks, the last one is open ended
+namespace profiler
+{
+  struct Stage
+  {
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t histogram[PROFILER_BUCKETS];
+  };
+
+  void start();
+#if defined(__AVR__)
+  inline uint16_t ticks() { return TCNT1; }
+#else
+  //provided by the host simulation
+  uint16_t ticks();
+#endif
+  void record(const uint8_t stage, const uint16_t duration);
+  const Stage& stage(const uint8_t stage);
+
+  //RECORD_LATENCY body, one stage per call in turn - the reported window is cleared
+  void writeTelemetry(telemetry::Record& record);
+}
+
+#endif
@@ -1,183 +1,122 @@
 #include<arduino.h>
+#include "sysclock.h"
 #include "pumps.h"
 
-BasePump::BasePump(const int pin_pump, const int pin_pot, const int time_per_cycle, const int iD, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS, const SoilSensorSegment* pSS) :
-  pinPump_(pin_pump), pinPot_(pin_pot), 
-  timePerCycle_( time_per_cycle - _DELAY_CONSTANT_SEC > 0 ? time_per_cycle : 2*_DELAY_CONSTANT_SEC ),
-  id(iD), pumpState_(idle), powerOnCycleCount_(0), timeLastStartSec_(0), timeLastStopSec_(0),
-  pSwitch(pS), pWaterSensor(pWS), pAirSensor(pAS), pSoilSensor(pSS)
+namespace
 {
-  initPump();
+  PumpTransition trace_[PUMP_TRACE_SIZE];
+  uint8_t traceHead_ = 0;
+  uint8_t traceCount_ = 0;
+  uint16_t traceTotal_ = 0;
+  uint16_t traceSent_ = 0;
+
+  //transition table, rows of one state in priority order
+  //all - every guard bit has to be set, any - one of them is enough
+  struct PumpTransitionRule
+  {
+    uint8_t from;
+    uint8_t to;
+    uint16_t guards;
+    uint8_t any;
+  };
+  const PumpTransitionRule PUMP_TRANSITIONS[] PROGMEM = {
+    {idle,   onAuto, G_TANK | G_AIR | G_SOIL_DRY | G_BUDGET | G_GRANT,  false},
+    {idle,   onMan,  G_TANK | G_SWITCH | G_GRANT,                       false},
+    {onAuto, off,    G_FLOW_FAULT | G_SOIL_WET | G_CYCLE_DONE,          true},
+    {onAuto, soak,   G_PULSE_DONE,                                      false},
+    {onAuto, idle,   G_NO_TANK,                                         false},
+    {onMan,  off,    G_FLOW_FAULT | G_NO_SWITCH | G_NO_TANK,            true},
+    {off,    onMan,  G_TANK | G_SWITCH | G_GRANT,                       false},
+    {off,    idle,   G_REST_OVER,                                       false},
+    {soak,   off,    G_SOIL_WET,                                        false},
+    {soak,   idle,   G_NO_TANK,                                         false},
+    {soak,   onMan,  G_TANK | G_SWITCH | G_GRANT,                       false},
+    {soak,   onAuto, G_TANK | G_SOAK_OVER | G_GRANT,                    false},
+  };
 }
 
-void BasePump::initPump() const
+State pumpTransition(const State from, const uint16_t guards)
 {
-  pinMode(pinPot_, INPUT);
-  pinMode(pinPump_, OUTPUT);
+  //the first row of the state whose guard matches wins
+  for(const PumpTransitionRule& rule : PUMP_TRANSITIONS)
+  {
+    if(pgm_read_byte(&rule.from) != from) continue;
 
-  digitalWrite(pinPump_, HIGH);
+    uint16_t mask = pgm_read_word(&rule.guards);
+    bool match = pgm_read_byte(&rule.any) ? guards & mask : (guards & mask) == mask;
+    if(match) return (State)pgm_read_byte(&rule.to);
+  }
+  return from;
 }
 
-void BasePump::startPump() const
+Q24_8 estimateWater(const unsigned long run_sec)
 {
-  digitalWrite(pinPump_, LOW);
-}
+  if(run_sec <= (unsigned long)_DELAY_CONSTANT_SEC) return Q24_8();
 
-void BasePump::stopPump() const
-{
-  digitalWrite(pinPump_, HIGH);
+  unsigned long pumping_sec = run_sec - _DELAY_CONSTANT_SEC;
+  if(pumping_sec > (unsigned long)_DAY_SEC) pumping_sec = _DAY_SEC;
+  return (_WATER_L_PER_SEC * (long)pumping_sec).convert<Q24_8>();
 }
 
-//pump control based on internal counters. no need for greater precision
-void BasePump::controlPump()
+namespace pumptrace
 {
-  unsigned long time_now_sec;
-
-  countTimeBetweenTurnsOn();
-  time_now_sec = millis()/1e3; 
-
-  //finite state machine
-  switch(pumpState_)
+  void record(const uint8_t pump_id, const uint8_t from, const uint8_t to, const uint16_t guards)
   {
-    case idle:
-      if( pWaterSensor->shouldWater() && pAirSensor->shouldWater() && ( pSoilSensor==nullptr ? true : pSoilSensor->shouldWater() ))
-      {
-        timeLastStartSec_ = millis()/1e3;
-        pumpState_ = onAuto;
-        ++powerOnCycleCount_;
-        startPump();
-      }
-      else if( pWaterSensor->shouldWater() && pSwitch->shouldWater() )
-      {
-        timeLastStartSec_ = millis()/1e3;
-        pumpState_ = onMan;
-        startPump();
-      }
-      break;
-    case onAuto:
-      if(( pSoilSensor==nullptr ? false : !pSoilSensor->shouldWater() ) || ( abs(time_now_sec - timeLastStartSec_) > timePerCycle_ ) )
-      {
-        timeLastStopSec_ = millis()/1e3;
-        pumpState_ = off;
-        stopPump();
-      }
-      else if( !pWaterSensor->shouldWater() )
-      {
-        timeLastStopSec_ = millis()/1e3;
-        pumpState_ = idle;
-        stopPump();
-      }
-      break;
-    case onMan:
-      if( !pSwitch->shouldWater() || !pWaterSensor->shouldWater() )
-      {
-        timeLastStopSec_ = millis()/1e3;
-        pumpState_ = off;
-        stopPump();
-      }
-      break;
-    case off:
-      if( pWaterSensor->shouldWater() && pSwitch->shouldWater() )
-      {
-        timeLastStartSec_ = millis()/1e3;
-        pumpState_ = onMan;
-        startPump();
-      }
-      else if ( abs(time_now_sec - timeLastStopSec_) > timeBetweenTurnsOn_ )
-      {
-        pumpState_ = idle;
-        stopPump();  //just to be sure
-      }
-      break;
+    PumpTransition& t = trace_[(traceHead_ + traceCount_) % PUMP_TRACE_SIZE];
+    t.timeSec = sysclock::nowSec();
+    t.pumpId = pump_id;
+    t.from = from;
+    t.to = to;
+    t.guards = guards;
+
+    if(traceCount_ < PUMP_TRACE_SIZE) ++traceCount_;
+    else traceHead_ = (traceHead_ + 1) % PUMP_TRACE_SIZE;
+    ++traceTotal_;
   }
-}
 
-PumpSS::PumpSS(const int pin_pump, const int pin_pot, const int time_per_cycle, const int iD, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS, const SoilSensorSegment* pSS) :
-  BasePump(pin_pump, pin_pot, time_per_cycle, iD, pS, pWS, pAS, pSS)
+  uint16_t total()
   {
-    countTimeBetweenTurnsOn();
+    return traceTotal_;
   }
 
-void PumpSS::countTimeBetweenTurnsOn()
-{  
-  timeBetweenTurnsOn_ = map(analogRead(pinPot_),0,1023,2*timePerCycle_,_20_MIN_SEC-timePerCycle_);
-}
-
-void PumpSS::printInfo() const
-{
-  Serial.print("Minimalny czas pomiedzy uruchomieniami pompy id=");
-  Serial.print(id);
-  Serial.print(" [min]: ");
-  Serial.println(timeBetweenTurnsOn_/60., 1);
-  Serial.print("Pompa id=");
-  Serial.print(id);
-  Serial.print(" zostala uruchomiona ");
-  Serial.print(powerOnCycleCount_);
-  Serial.println(" razy");
-  Serial.print("Pompa id=");
-  Serial.print(id);
-  switch(pumpState_)
+  uint8_t count()
   {
-    case idle:
-      Serial.println(" w stanie oczekiwania");
-      break;
-    case onAuto:
-      Serial.println(" wlaczona automatycznie");
-      break;
-    case onMan:
-      Serial.println(" wlaczona manualnie");
-      break;
-    case off:
-      Serial.println(" wylaczona");
-      break;
+    return traceCount_;
   }
-}
 
-PumpWT::PumpWT(const int pin_pump, const int pin_pot, const int time_per_cycle, const int iD, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS) :
-  BasePump(pin_pump, pin_pot, time_per_cycle, iD, pS, pWS, pAS, nullptr), 
-  waterPerCycle_( (timePerCycle_ - _DELAY_CONSTANT_SEC) * _WATER_L_PER_SEC )
-{
-  countTimeBetweenTurnsOn();
-}
+  const PumpTransition& get(const uint8_t i)
+  {
+    return trace_[(traceHead_ + i) % PUMP_TRACE_SIZE];
+  }
 
-void PumpWT::countTimeBetweenTurnsOn()
-{  
-  waterPerDay_ = map(analogRead(pinPot_),0,1023,maxWaterPerDay_*100,waterPerCycle_*100);
-  waterPerDay_ /= 100;
+  //overwritten entries are lost, the gap shows in the first timestamp
+  uint16_t pending()
+  {
+    uint16_t pending = traceTotal_ - traceSent_;
+    return pending > traceCount_ ? traceCount_ : pending;
+  }
 
-  timeBetweenTurnsOn_ = _DAY_SEC / ( waterPerDay_ / waterPerCycle_ );
-}
+  uint8_t writeTelemetry(telemetry::Record& record)
+  {
+    uint16_t pending = pumptrace::pending();
+    if(pending == 0) return 0;
+    const uint8_t n = pending < PUMP_TRACE_PER_RECORD ? pending : PUMP_TRACE_PER_RECORD;
+
+    record.put8(n);
+    for(uint8_t i = traceCount_ - pending; i < traceCount_ - pending + n; ++i)
+    {
+      const PumpTransition& t = get(i);
+      record.put32(t.timeSec);
+      record.put8(t.pumpId);
+      record.put8(t.from);
+      record.put8(t.to);
+      record.put16(t.guards);
+    }
+    return n;
+  }
 
-void PumpWT::printInfo() const
-{
-  Serial.print("Minimalny czas pomiedzy uruchomieniami pompy id=");
-  Serial.print(id);
-  Serial.print(" [min]: ");
-  Serial.print(timeBetweenTurnsOn_/60., 1);
-  Serial.print(" -> ");
-  Serial.print(waterPerDay_, 1);
-  Serial.println(" [litry na dzien]");
-  Serial.print("Pompa id=");
-  Serial.print(id);
-  Serial.print(" zostala uruchomiona ");
-  Serial.print(powerOnCycleCount_);
-  Serial.println(" razy");
-  Serial.print("Pompa id=");
-  Serial.print(id);
-  switch(pumpState_)
+  void sent(const uint8_t n)
   {
-    case idle:
-      Serial.println(" w stanie oczekiwania");
-      break;
-    case onAuto:
-      Serial.println(" wlaczona automatycznie");
-      break;
-    case onMan:
-      Serial.println(" wlaczona manualnie");
-      break;
-    case off:
-      Serial.println(" wylaczona");
-      break;
+    traceSent_ = traceTotal_ - pending() + n;
   }
 }
-
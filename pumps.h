@@ -1,69 +1,68 @@
 #ifndef PUMPS_H
 #define PUMPS_H
 
-#include "sensors.h"
+#include "fixed.h"
+#include "telemetry.h"
 
-enum State {idle, onAuto, onMan, off};
+//soak - between two pulses of an automatic cycle, the water soaks in with the pump stopped
+enum State {idle, onAuto, onMan, off, soak};
 const int _MAX_WATER_PER_DAY_L = 50;
-const double _WATER_L_PER_SEC = 0.05;
+constexpr Q16_16 _WATER_L_PER_SEC = Q16_16::fromDouble(0.05);
 const int _DELAY_CONSTANT_SEC = 10;
 const long _DAY_SEC = 86400;
 const int _20_MIN_SEC = 1200;
+const int PUMP_CONTROL_MS = 100;
+const int _NO_FLOW_SEC = _DELAY_CONSTANT_SEC + 5;   //no pulse for this long while pumping - dry run
+const int _BURST_FACTOR = 2;                        //flow over _BURST_FACTOR * _WATER_L_PER_SEC - burst hose
+enum FlowFault {FLOW_DRY_RUN = 1, FLOW_BURST = 2};
 
-class BasePump
+//pump FSM guards, evaluated once per control tick - negations have their own bits
+enum PumpGuard
 {
-  private:
-    const int pinPump_;
-    const int pinPot_;
-    enum State pumpState_;
-    int timePerCycle_;
-    unsigned long timeBetweenTurnsOn_;
-    unsigned long timeLastStartSec_;
-    unsigned long timeLastStopSec_;
-    unsigned int powerOnCycleCount_;
-    Switch const* pSwitch;
-    WaterSensor const* pWaterSensor;
-    AirSensor const* pAirSensor;
-    SoilSensorSegment const* pSoilSensor;
-    const int id;
-    void initPump() const;
-    virtual void countTimeBetweenTurnsOn() = 0;
-  public:
-    BasePump(const int pin_pump, const int pin_pot, const int iD, const int time_per_cycle, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS, const SoilSensorSegment* pSS);
-    virtual ~BasePump() {};
-    void controlPump();
-    void startPump() const;
-    void stopPump() const;
-    virtual void printInfo() const = 0;
-
-    friend class PumpSS;
-    friend class PumpWT;
+  G_TANK = 1 << 0,
+  G_NO_TANK = 1 << 1,
+  G_AIR = 1 << 2,
+  G_SOIL_DRY = 1 << 3,     //also set without a soil sensor
+  G_SOIL_WET = 1 << 4,
+  G_BUDGET = 1 << 5,
+  G_SWITCH = 1 << 6,
+  G_NO_SWITCH = 1 << 7,
+  G_CYCLE_DONE = 1 << 8,
+  G_FLOW_FAULT = 1 << 9,
+  G_REST_OVER = 1 << 10,
+  G_GRANT = 1 << 11,       //the arbiter let the pump start
+  G_PULSE_DONE = 1 << 12,  //a pulse of the cycle is over and more are left
+  G_SOAK_OVER = 1 << 13
 };
 
-//class for pump controlled by soil sensors
-//potentiometer used for setting the shortest period of time between turning on (from 2*timePerCycle_ up to about 20 min)
-class PumpSS : public BasePump
+//ring buffer of the last pump state changes with the guards that caused them
+const int PUMP_TRACE_SIZE = 16;
+const int PUMP_TRACE_PER_RECORD = 6;   //9 bytes each, fits TELEMETRY_MAX_RECORD
+struct PumpTransition
 {
-  private:
-    void countTimeBetweenTurnsOn();
-  public:
-    PumpSS(const int pin_pump, const int pin_pot, const int iD, const int time_per_cycle, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS, const SoilSensorSegment* pSS);
-    ~PumpSS() {};
-    void printInfo() const;
+  uint32_t timeSec;
+  uint8_t pumpId;
+  uint8_t from;
+  uint8_t to;
+  uint16_t guards;
 };
 
-//class for pump controlled by timer
-//potentiometer used for changing max water per day per pump (from amount of water per one cycle up to _MAX_WATER_PER_DAY_L)
-class PumpWT : public BasePump
+namespace pumptrace
 {
-  private:
-    const double waterPerCycle_;
-    const int maxWaterPerDay_ = _MAX_WATER_PER_DAY_L;
-    double waterPerDay_;
-    void countTimeBetweenTurnsOn();
-  public:
-    PumpWT(const int pin_pump, const int pin_pot, const int iD, const int time_per_cycle, const Switch* pS, const WaterSensor* pWS, const AirSensor* pAS);
-    ~PumpWT() {};
-    void printInfo() const;
-};
+  void record(const uint8_t pump_id, const uint8_t from, const uint8_t to, const uint16_t guards);
+  uint16_t total();      //transitions since boot, wraps
+  uint8_t count();
+  const PumpTransition& get(const uint8_t i);  //0 - oldest
+  uint16_t pending();
+  //RECORD_TRACE with the oldest transitions not sent yet, returns how many (0 - none)
+  uint8_t writeTelemetry(telemetry::Record& record);
+  //the record made it into the TX queue, the next one starts after its n transitions
+  void sent(const uint8_t n);
+}
+
+//the pump FSM: next state for the guards of this tick, from when no transition matches
+State pumpTransition(const State from, const uint16_t guards);
+//water for run_sec of pumping at the nominal flow, the first _DELAY_CONSTANT_SEC only fill the pipes
+Q24_8 estimateWater(const unsigned long run_sec);
+
 #endif
@@ -0,0 +1,70 @@
+#include "sysclock.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "watchdog.h"
+
+Scheduler::Scheduler() :
+  taskCount_(0), nextDueMs_(0) {}
+
+bool Scheduler::addTask(Task task, const unsigned long first_run_ms, Quiet quiet)
+{
+  if(taskCount_ == MAX_TASKS) return false;
+
+  tasks_[taskCount_].run = task;
+  tasks_[taskCount_].quiet = quiet;
+  tasks_[taskCount_].dueMs = sysclock::nowMs() + first_run_ms;
+  ++taskCount_;
+  updateNextDue();
+  return true;
+}
+
+//differences are evaluated as signed values, so the comparisons survive the clock wrap
+void Scheduler::updateNextDue()
+{
+  nextDueMs_ = tasks_[0].dueMs;
+  for(int i = 1; i < taskCount_; ++i)
+    if( (int32_t)(tasks_[i].dueMs - nextDueMs_) < 0 ) nextDueMs_ = tasks_[i].dueMs;
+}
+
+uint32_t Scheduler::nextChangeMs() const
+{
+  uint32_t time_now_ms = sysclock::nowMs();
+  uint32_t next_ms = time_now_ms + QUIET_MAX_MS;
+
+  for(int i = 0; i < taskCount_; ++i)
+  {
+    uint32_t due_ms = tasks_[i].dueMs;
+    if(tasks_[i].quiet)
+    {
+      unsigned long quiet_ms = tasks_[i].quiet();
+      uint32_t quiet_until_ms = time_now_ms + (quiet_ms < QUIET_MAX_MS ? quiet_ms : QUIET_MAX_MS);
+      if( (int32_t)(quiet_until_ms - due_ms) > 0 ) due_ms = quiet_until_ms;
+    }
+    if( (int32_t)(due_ms - next_ms) < 0 ) next_ms = due_ms;
+  }
+  return next_ms;
+}
+
+bool Scheduler::isDue() const
+{
+  return taskCount_ && (int32_t)(sysclock::nowMs() - nextDueMs_) >= 0;
+}
+
+void Scheduler::tick()
+{
+  uint32_t time_now_ms = sysclock::nowMs();
+
+  if( !taskCount_ || (int32_t)(time_now_ms - nextDueMs_) < 0 ) return;
+
+  for(int i = 0; i < taskCount_; ++i)
+  {
+    if( (int32_t)(time_now_ms - tasks_[i].dueMs) >= 0 )
+    {
+      uint16_t start = profiler::ticks();
+      watchdog::mark(watchdog::STAGE_TASK + i);
+      tasks_[i].dueMs = time_now_ms + tasks_[i].run();
+      profiler::record(i, profiler::ticks() - start);
+    }
+  }
+  updateNextDue();
+}
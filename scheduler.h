@@ -0,0 +1,40 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+const int MAX_TASKS = 8;
+
+//task body - does its work and returns the number of ms after which it wants to run again
+typedef unsigned long (*Task)();
+//ms for which a run of the task would change nothing as long as no input pin changes, 0 - unknown
+//only the host simulation acts on it (fast forward), the board runs every task on its period
+typedef unsigned long (*Quiet)();
+const unsigned long QUIET_MAX_MS = 3600000UL;
+
+//cooperative scheduler, tick() returns right away when nothing is due
+class Scheduler
+{
+  private:
+    struct Entry
+    {
+      Task run;
+      Quiet quiet;
+      uint32_t dueMs;
+    };
+    Entry tasks_[MAX_TASKS];
+    int taskCount_;
+    uint32_t nextDueMs_;
+    void updateNextDue();
+  public:
+    Scheduler();
+    ~Scheduler() {};
+    bool addTask(Task task, const unsigned long first_run_ms, Quiet quiet = nullptr);
+    void tick();
+    bool isDue() const;
+    uint32_t nextDueMs() const { return nextDueMs_; }
+    //the next run that can change anything: a task is skipped while it is quiet, at most QUIET_MAX_MS ahead
+    uint32_t nextChangeMs() const;
+};
+
+#endif
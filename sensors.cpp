@@ -1,16 +1,41 @@
+#include "sysclock.h"
+#include "scheduler.h"
 #include "sensors.h"
+#include "et.h"
+
+namespace
+{
+  //flow meters by slot
+  volatile uint16_t flowPulses_[FLOW_MAX_METERS];
+  uint16_t flowPulsesPerL_[FLOW_MAX_METERS];
+  uint16_t flowLastCount_[FLOW_MAX_METERS];
+  uint32_t flowCyclePulses_[FLOW_MAX_METERS];
+  uint32_t flowLastPulseMs_[FLOW_MAX_METERS];
+  uint8_t flowMeterCount_ = 0;
+
+  template<uint8_t slot> void flowPulse() { ++flowPulses_[slot]; }
+#if defined(FASTIO_MEGA)
+  void (*const FLOW_ISR[])() = {flowPulse<0>, flowPulse<1>, flowPulse<2>, flowPulse<3>};
+#else
+  void (*const FLOW_ISR[])() = {flowPulse<0>, flowPulse<1>};
+#endif
+  static_assert(sizeof(FLOW_ISR) / sizeof(FLOW_ISR[0]) == FLOW_MAX_METERS, "an ISR per flow meter slot");
+}
 
 BaseSensor::BaseSensor(const int read_every_sec, const int ready_after_sec) :
-  shouldBeWatered_(false), timeLastSec_(0), readEverySec_(read_every_sec), readyAfterSec_(ready_after_sec){}
+  shouldBeWatered_(false), readEverySec_(read_every_sec), readyAfterSec_(ready_after_sec){}
 
 AirSensor::AirSensor(int pin_dht11, const int pin_led, int pin_interrupt, void (*callback_wrapper)()) :
   BaseSensor(60,15),
   idDHT11(pin_dht11,digitalPinToInterrupt(pin_dht11),callback_wrapper),
   pinLed_(pin_led),
-  temperature_(20.20),
-  humidity_(60.60),
-  dewPoint_(10.10),
-  sensorError_(false)
+  ledIo_(pin_led),
+  temperature_(Q8_8::fromDouble(20.20)),
+  humidity_(Q8_8::fromDouble(60.60)),
+  dewPoint_(Q8_8::fromDouble(10.10)),
+  sensorError_(false),
+  acquisitionPending_(false),
+  errorCount_(0)
 {
    initSensor();
 }
@@ -21,136 +46,103 @@ void AirSensor::initSensor() const
   digitalWrite(pinLed_, LOW);
 }
 
+//the DHT11 is sampled asynchronously - the reading started on one call is collected on a later one
 void AirSensor::readSensor()
 {
-   unsigned long time_now_sec = millis()/1e3;
-   static int errorCount;
-
-   if( (( abs(time_now_sec - timeLastSec_) > readEverySec_) || !timeLastSec_ ) && (time_now_sec > readyAfterSec_) )
+   if(acquisitionPending_)
    {
-      int result;
-      
-      timeLastSec_ = time_now_sec;
-      result = idDHT11::acquireAndWait();
-      
-      switch (result)
-      {
-        case IDDHTLIB_OK: 
-          temperature_ = idDHT11::getCelsius();
-          humidity_ = idDHT11::getHumidity();
-          dewPoint_ = idDHT11::getDewPoint();
-          sensorError_ = false;
-          errorCount = 0;
-          break;
-        case IDDHTLIB_ERROR_CHECKSUM: 
-        case IDDHTLIB_ERROR_ISR_TIMEOUT: 
-        case IDDHTLIB_ERROR_RESPONSE_TIMEOUT: 
-        case IDDHTLIB_ERROR_DATA_TIMEOUT: 
-        case IDDHTLIB_ERROR_ACQUIRING: 
-        case IDDHTLIB_ERROR_DELTA: 
-        case IDDHTLIB_ERROR_NOTSTARTED: 
-        default: 
-          ++errorCount;
-          if( errorCount > ( QUARTER_SEC/readEverySec_ ) )
-          {
-            sensorError_ = true;
-            temperature_ = 0;
-            humidity_ = 0;
-            dewPoint_ = -1;
-          }
-          break;
-      }
+      if(idDHT11::acquiring()) return;
 
-      if(sensorError_) digitalWrite(pinLed_, HIGH);
-      else digitalWrite(pinLed_, LOW);
-      
-      if( ( (humidity_ < stopWateringHumidity_) && (temperature_ > dewPoint_) && (temperature_ > GROUND_FROST_TEMP_DEG) ) || sensorError_) 
-        shouldBeWatered_ = true;
-      else shouldBeWatered_ = false;
+      acquisitionPending_ = false;
+      updateReadings(idDHT11::getStatus());
+   }
+   else
+   {
+      idDHT11::acquire();
+      acquisitionPending_ = true;
    }
 }
 
-void AirSensor::printInfo() const
-{
-  Serial.print("Temperatura powietrza (oC): ");
-  Serial.println(temperature_, 2);
-    
-  Serial.print("Wilgotnosc wzgledna powietrza (%): ");
-  Serial.println(humidity_, 2);
-    
-  Serial.print("Punkt rosy (oC): ");
-  Serial.println(dewPoint_, 2);
-}
-
-SoilSensorSegment::SoilSensorSegment(const int p1, const int p2, const int iD) :
-  BaseSensor(5,1), pin_{p1,p2}, id(iD)
+unsigned long AirSensor::nextReadMs() const
 {
-  dryness_[0] = false;
-  dryness_[1] = false;
-  drynessCount_[0] = 0;
-  drynessCount_[1] = 0;
-  initSensor();
+  return acquisitionPending_ ? DHT11_POLL_MS : BaseSensor::nextReadMs();
 }
 
-void SoilSensorSegment::initSensor()const
+void AirSensor::updateReadings(const int result)
 {
-  pinMode(pin_[0], INPUT);
-  pinMode(pin_[1], INPUT);
-}
-    
-void SoilSensorSegment::readSensor()
-{
-  unsigned int time_now_sec = millis()/1e3;
-
-  if( (( abs(time_now_sec - timeLastSec_) > readEverySec_) || !timeLastSec_ ) && (time_now_sec > readyAfterSec_) )
-  {     
-    timeLastSec_ = time_now_sec;
-
-    for(int i = 0; i<2; ++i)
-    {
-      if(digitalRead(pin_[i])) 
+  switch (result)
+  {
+    case IDDHTLIB_OK: 
+      temperature_ = Q8_8::fromRaw(idDHT11::getCelsiusFixed());
+      humidity_ = Q8_8::fromRaw(idDHT11::getHumidityFixed());
+      dewPoint_ = Q8_8::fromRaw(idDHT11::getDewPointFixed());
+      sensorError_ = false;
+      errorCount_ = 0;
+      et::sample(temperature_, humidity_);
+      break;
+    case IDDHTLIB_ERROR_CHECKSUM: 
+    case IDDHTLIB_ERROR_ISR_TIMEOUT: 
+    case IDDHTLIB_ERROR_RESPONSE_TIMEOUT: 
+    case IDDHTLIB_ERROR_DATA_TIMEOUT: 
+    case IDDHTLIB_ERROR_ACQUIRING: 
+    case IDDHTLIB_ERROR_DELTA: 
+    case IDDHTLIB_ERROR_NOTSTARTED: 
+    default: 
+      ++errorCount_;
+      if( errorCount_ > ( QUARTER_SEC/readEverySec_ ) )
       {
-        dryness_[i] = true;
-        ++drynessCount_[i];
+        sensorError_ = true;
+        temperature_ = Q8_8::fromInt(0);
+        humidity_ = Q8_8::fromInt(0);
+        dewPoint_ = Q8_8::fromInt(-1);
       }
-      else  dryness_[i] = false;
-    }
-
-    if(dryness_[0] && dryness_[1])  shouldBeWatered_ = true;
-    else  shouldBeWatered_ = false; 
+      break;
   }
+
+  fastio::write(ledIo_, sensorError_);
+  
+  if( ( (humidity_ < stopWateringHumidity_) && (temperature_ > dewPoint_) && (temperature_ > GROUND_FROST_TEMP_DEG) ) || sensorError_) 
+    shouldBeWatered_ = true;
+  else shouldBeWatered_ = false;
 }
+
+void AirSensor::printInfo() const
+{
+  Serial.print(F("Temperatura powietrza (oC): "));
+  printFixed(temperature_, 2);
+  Serial.println();
     
-void SoilSensorSegment::printInfo() const
-{
-  Serial.print("Wilgotnosc gleby dla segmentu id=");
-  Serial.print(id);
-  Serial.println(": ");
-  for(int i=0; i<2; ++i) {
-    Serial.print("czujnik ");
-    Serial.print(i+1);
-    Serial.print(": ");
-    if(dryness_[i]) Serial.println("sucho");
-    else Serial.println("wilgotno");
-  }
-  for(int i=0; i<2; ++i)
-  {
-    Serial.print("czujnik ");
-    Serial.print(i+1);
-    Serial.print(" wykryl suchosc gleby ");
-    Serial.print(drynessCount_[i]);
-    Serial.println(" razy");
-  }
+  Serial.print(F("Wilgotnosc wzgledna powietrza (%): "));
+  printFixed(humidity_, 2);
+  Serial.println();
+    
+  Serial.print(F("Punkt rosy (oC): "));
+  printFixed(dewPoint_, 2);
+  Serial.println();
+}
+
+void AirSensor::writeTelemetry(telemetry::Record& record) const
+{
+  record.put16(temperature_.raw());
+  record.put16(humidity_.raw());
+  record.put16(dewPoint_.raw());
+  record.put8(shouldWater() | sensorError_ << 1);
+  record.put16(et::dailyMm().raw());
+  record.put8(et::hours());
 }
 
 WaterSensor::WaterSensor(const int pin_sensor, const int pin_buzzer, void (*callback_wrapper)()) :
   BaseSensor(0,0),  //irrelevant - just for the interface inheritance
   pinSensor_(pin_sensor),
-  pinBuzzer_(pin_buzzer)
+  pinBuzzer_(pin_buzzer),
+  sensorIo_(pin_sensor),
+  buzzerIo_(pin_buzzer),
+  lastEdgeMs_(0),
+  settling_(false)
 {
   initSensor();
   attachInterrupt(digitalPinToInterrupt(pinSensor_), callback_wrapper, CHANGE);
-  readSensor();
+  applyLevel();
 }
 
 void WaterSensor::initSensor() const
@@ -161,56 +153,107 @@ void WaterSensor::initSensor() const
   digitalWrite(pinBuzzer_, LOW);
 }
 
+//interrupt context - only records the edge, a sloshing tank costs a few instructions per edge
+void WaterSensor::isrCallback()
+{
+  events::post(events::WATER_LEVEL);
+}
+
+void WaterSensor::applyLevel()
+{
+  shouldBeWatered_ = !fastio::read(sensorIo_);
+  fastio::write(buzzerIo_, !shouldWater());
+}
+
+//the level is taken once the float switch has been still for WATER_SETTLE_MS
 void WaterSensor::readSensor()
 {
-  shouldBeWatered_ = !digitalRead(pinSensor_);
-  
-  if(!shouldWater()) digitalWrite(pinBuzzer_, HIGH);
-  else digitalWrite(pinBuzzer_, LOW);
+  uint32_t edge_ms;
+
+  if(events::take(events::WATER_LEVEL, edge_ms))
+  {
+    lastEdgeMs_ = edge_ms;
+    settling_ = true;
+  }
+  //signed - the edge may be newer than the time sampled for this pass
+  if(settling_ && (int32_t)(sysclock::nowMs() - lastEdgeMs_) >= WATER_SETTLE_MS)
+  {
+    settling_ = false;
+    applyLevel();
+  }
 }
 
-void WaterSensor::printInfo() const
+unsigned long WaterSensor::nextReadMs() const
 {
-  if(shouldWater()) Serial.println("W zbiorniku jest woda");
-  else Serial.println("BRAK WODY W ZBIORNIKU!");
+  if(!settling_) return WATER_POLL_MS;
+
+  int32_t left_ms = WATER_SETTLE_MS - (int32_t)(sysclock::nowMs() - lastEdgeMs_);
+  return left_ms > 0 ? left_ms : 0;
 }
 
-Switch::Switch(const int pin) :
-  BaseSensor(0,0), //irrelevant - just for the interface inheritance
-  pin_(pin),
-  auxFirstTime_(0),
-  auxSwitchState_(0)
+unsigned long WaterSensor::quietMs() const
 {
-  initSensor();
-  readSensor();
+  return settling_ || events::pending(events::WATER_LEVEL) ? 0 : QUIET_MAX_MS;
 }
 
-void Switch::initSensor() const
+void WaterSensor::printInfo() const
 {
-    pinMode(pin_, INPUT_PULLUP);
+  if(shouldWater()) Serial.println(F("W zbiorniku jest woda"));
+  else Serial.println(F("BRAK WODY W ZBIORNIKU!"));
 }
 
-//oscillation resistant method
-void Switch::readSensor()
-{ 
-  shouldBeWatered_ = !digitalRead(pin_);
+void WaterSensor::writeTelemetry(telemetry::Record& record) const
+{
+  record.put8(shouldWater());
+}
 
-  if(!auxSwitchState_ && shouldBeWatered_)
+namespace flow
+{
+  uint8_t attach(const int pin, const uint16_t pulses_per_l)
   {
-    ++auxSwitchState_;
-    auxFirstTime_ = millis();
+    if(!pulses_per_l || flowMeterCount_ == FLOW_MAX_METERS || digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT) return FLOW_NO_METER;
+
+    uint8_t slot = flowMeterCount_++;
+    flowPulsesPerL_[slot] = pulses_per_l;
+    pinMode(pin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(pin), FLOW_ISR[slot], FALLING);
+    return slot;
   }
-  else if(auxSwitchState_)
+
+  void read(const uint8_t slot)
   {
-    if( (millis() - auxFirstTime_ > 50) && !shouldBeWatered_ )
-    {
-      shouldBeWatered_ = false;
-      auxSwitchState_ = 0;
-    }
-    else if( (millis() - auxFirstTime_ > 50) && shouldBeWatered_ )
-    {
-       shouldBeWatered_ = true;
-    }
+    if(slot == FLOW_NO_METER) return;
+
+    noInterrupts();
+    uint16_t count = flowPulses_[slot];
+    interrupts();
+
+    //unsigned difference - the ISR counter wraps freely
+    uint16_t delta = count - flowLastCount_[slot];
+    flowLastCount_[slot] = count;
+    if(!delta) return;
+
+    flowCyclePulses_[slot] += delta;
+    flowLastPulseMs_[slot] = sysclock::nowMs();
   }
-}
 
+  void startCycle(const uint8_t slot)
+  {
+    if(slot == FLOW_NO_METER) return;
+
+    read(slot);
+    flowCyclePulses_[slot] = 0;
+    flowLastPulseMs_[slot] = sysclock::nowMs();
+  }
+
+  Q24_8 cycleLitres(const uint8_t slot)
+  {
+    if(slot == FLOW_NO_METER) return Q24_8();
+    return Q24_8::fromRaw(flowCyclePulses_[slot] * Q24_8::ONE / flowPulsesPerL_[slot]);
+  }
+
+  uint32_t msSinceLastPulse(const uint8_t slot)
+  {
+    return slot == FLOW_NO_METER ? 0 : sysclock::elapsedMs(flowLastPulseMs_[slot]);
+  }
+}
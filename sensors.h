@@ -2,63 +2,69 @@
 #define SENSORS_H
 
 #include "idDHT11.h"
+#include "fastio.h"
+#include "events.h"
+#include "sysclock.h"
+#include "fixed.h"
+#include "telemetry.h"
 
 const int QUARTER_SEC = 3600/4;
-const double GROUND_FROST_TEMP_DEG = 5;
+constexpr Q8_8 GROUND_FROST_TEMP_DEG = Q8_8::fromInt(5);
+const int DHT11_POLL_MS = 25;
+const int WATER_POLL_MS = 100;
+const int WATER_SETTLE_MS = 500;    //float switch has to be still for this long
+//external interrupts left by the water sensor and the DHT11
+#if defined(FASTIO_MEGA)
+const int FLOW_MAX_METERS = 4;      //Mega: INT0..INT3 (D21..D18)
+#else
+const int FLOW_MAX_METERS = 2;      //Leonardo: INT2 (D0), INT3 (D1)
+#endif
 
+//common state of all sensors, no virtual interface - sensors are always used through their concrete type
+//every sensor provides initSensor(), readSensor() and printInfo(), nextReadMs() may be redefined
 class BaseSensor
 {
   private:
     bool shouldBeWatered_;
-    unsigned long timeLastSec_;
     const int readEverySec_;
     const int readyAfterSec_;
-    virtual void initSensor() const = 0;
   public:
     BaseSensor(const int read_every_sec, const int ready_after_sec);
-    virtual ~BaseSensor() {};
-    virtual void readSensor() = 0;
+    ~BaseSensor() {};
     bool shouldWater() const { return shouldBeWatered_; }
-    virtual void printInfo() const = 0;
+    //readSensor() is called by the scheduler, these tell it when
+    unsigned long firstReadMs() const { return 1000UL*readyAfterSec_; }
+    unsigned long nextReadMs() const { return 1000UL*readEverySec_; }
 
     friend class AirSensor;
-    friend class SoilSensorSegment;
     friend class WaterSensor;
-    friend class Switch;
 };
 
 class AirSensor : public BaseSensor, public idDHT11
 {
   private:
     const int pinLed_;
-    double temperature_;
-    double humidity_;
-    double dewPoint_;
+    const fastio::Pin ledIo_;
+    Q8_8 temperature_;
+    Q8_8 humidity_;
+    Q8_8 dewPoint_;
     bool sensorError_;
-    const double stopWateringHumidity_ = 80;
+    bool acquisitionPending_;
+    int errorCount_;
+    const Q8_8 stopWateringHumidity_ = Q8_8::fromInt(80);
     void initSensor() const;
+    void updateReadings(const int result);
   public:
     AirSensor() = delete;
     AirSensor(int pin_dht11, const int pin_led, int pin_interrupt, void (*callback_wrapper)());
     ~AirSensor() {};
     void readSensor();
+    unsigned long nextReadMs() const;
     void printInfo() const;
-};
-
-class SoilSensorSegment : public BaseSensor
-{
-  private:
-    const int pin_[2];
-    bool dryness_[2];
-    unsigned int drynessCount_[2];
-    const int id;
-    void initSensor() const;
-  public:
-    SoilSensorSegment() = delete;
-    SoilSensorSegment(const int p1, const int p2, const int iD);
-    ~SoilSensorSegment() {};
-    void readSensor();
-    void printInfo() const;
+    void writeTelemetry(telemetry::Record& record) const;
+    Q8_8 temperature() const { return temperature_; }
+    Q8_8 humidity() const { return humidity_; }
+    bool sensorError() const { return sensorError_; }
 };
 
 class WaterSensor : public BaseSensor
@@ -66,30 +72,37 @@ class WaterSensor : public BaseSensor
   private:
     const int pinSensor_;
     const int pinBuzzer_;
+    const fastio::Pin sensorIo_;
+    const fastio::Pin buzzerIo_;
+    uint32_t lastEdgeMs_;
+    bool settling_;
     void initSensor() const;
-    static void readSensorWrapper();
+    void applyLevel();
   public:
     WaterSensor() = delete;
     WaterSensor(const int pin_sensor, const int pin_buzzer, void (*callback_wrapper)());
     ~WaterSensor() {};
+    void isrCallback();
     void readSensor();
+    unsigned long nextReadMs() const;
+    //the level only moves with an edge, nothing to do while none is pending or settling
+    unsigned long quietMs() const;
     void printInfo() const;
+    void writeTelemetry(telemetry::Record& record) const;
 };
 
-class Switch : public BaseSensor
+//hall effect flow sensors on external interrupt pins, the ISRs only count pulses
+//a meter is addressed by its slot, zones without a meter hold FLOW_NO_METER
+const uint8_t FLOW_NO_METER = FLOW_MAX_METERS;
+namespace flow
 {
-  private:
-    const int pin_;
-    unsigned long auxFirstTime_;
-    int auxSwitchState_;
-    bool auxSwitchOn_;
-    void initSensor() const;
-  public:
-    Switch() = delete;
-    Switch(const int pin);
-    ~Switch() {};
-    void readSensor();
-    void printInfo() const {};
-};
+  //pulses_per_l is the calibration of the meter, 0 - no meter fitted; returns the slot
+  uint8_t attach(const int pin, const uint16_t pulses_per_l);
+  //takes the pulses counted since the last call, has to run at least every 65535 pulses
+  void read(const uint8_t slot);
+  void startCycle(const uint8_t slot);
+  Q24_8 cycleLitres(const uint8_t slot);
+  uint32_t msSinceLastPulse(const uint8_t slot);
+}
 
 #endif
@@ -0,0 +1,121 @@
+#ifndef SIM_ARDUINO_H
+#define SIM_ARDUINO_H
+
+//host replacement of the Arduino core used by the simulation build (see sim/main.cpp)
+//everything is backed by the virtual-time HAL in sim/sim.cpp
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+
+#if defined(__AVR_ATmega2560__)
+//ATmega2560 EEPROM, last address
+#define E2END 0xFFF
+
+//Arduino Mega analog pin numbering
+static const uint8_t A0 = 54;
+static const uint8_t A1 = 55;
+static const uint8_t A2 = 56;
+static const uint8_t A3 = 57;
+static const uint8_t A4 = 58;
+static const uint8_t A5 = 59;
+static const uint8_t A6 = 60;
+static const uint8_t A7 = 61;
+static const uint8_t A8 = 62;
+static const uint8_t A9 = 63;
+static const uint8_t A10 = 64;
+static const uint8_t A11 = 65;
+static const uint8_t A12 = 66;
+static const uint8_t A13 = 67;
+static const uint8_t A14 = 68;
+static const uint8_t A15 = 69;
+#else
+//ATmega32U4 EEPROM, last address
+#define E2END 0x3FF
+
+//Arduino Leonardo analog pin numbering
+static const uint8_t A0 = 18;
+static const uint8_t A1 = 19;
+static const uint8_t A2 = 20;
+static const uint8_t A3 = 21;
+static const uint8_t A4 = 22;
+static const uint8_t A5 = 23;
+#endif
+
+//flash and RAM share one address space on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define F(s) (s)
+
+//same semantics as the AVR core macro (also for unsigned arguments)
+#define abs(x) ((x)>0?(x):-(x))
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+//interrupts are only delivered while virtual time advances, so there is nothing to mask
+void noInterrupts();
+void interrupts();
+
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt_num, void (*user_func)(), int mode);
+void detachInterrupt(uint8_t interrupt_num);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+//64 byte transmit buffer drained at the configured baud rate, writes block only when it is full
+//received bytes come from sim::serialReceive()
+class SimSerial
+{
+  private:
+    unsigned long baud_;
+    uint64_t idleAtUs_;
+    void put(const char* s);
+  public:
+    SimSerial() : baud_(0), idleAtUs_(0) {}
+    void begin(unsigned long baud) { baud_ = baud; }
+    int available();
+    int read();
+    int availableForWrite();
+    size_t write(uint8_t c);
+    void print(const char* s);
+    void print(char c);
+    void print(int n);
+    void print(unsigned int n);
+    void print(long n);
+    void print(unsigned long n);
+    void print(double n, int digits = 2);
+    void println();
+    template<typename T> void println(T n) { print(n); println(); }
+    void println(double n, int digits = 2) { print(n, digits); println(); }
+};
+
+extern SimSerial Serial;
+
+#endif
@@ -0,0 +1,493 @@
+//model checker of the pump and sensor logic, see check.h
+//
+//two zone registries of its own are built - timer driven on the zone pins with a flow meter on
+//zone 1 and soil driven on spare pins - the firmware loop is not run. every step picks new inputs
+//(tank, weather, soil, switches, flow rate, knob), jumps virtual time, lets the sensors take the
+//inputs like their tasks would and runs one control tick of all pumps. the invariants are checked against the inputs,
+//so a sensor or pump bug shows as a violation, not as a consistent wrong answer
+//the soil registry lets one pump run at a time, so its zones always compete for the start arbiter,
+//both registries water in pulses (cycle and soak)
+//
+//the clock starts ten minutes before the millis() wrap and long jumps carry it over the
+//wrap many times (and over the 32-bit seconds wrap in long runs)
+
+#include <stdio.h>
+#include <chrono>
+#include "Arduino.h"
+#include "sim.h"
+#include "check.h"
+#include "config.h"
+#include "sensors.h"
+#include "pumps.h"
+#include "topology.h"
+#include "adc.h"
+#include "et.h"
+
+#if !defined(FASTIO_MEGA)
+namespace
+{
+  const uint16_t CHECK_PULSES_PER_L = 450;
+  const unsigned long NOMINAL_HZ = (_WATER_L_PER_SEC * (long)CHECK_PULSES_PER_L).toInt();
+  const unsigned long RUNNING_JUMP_MS = 1000;   //a stall longer than this resets the board (watchdog)
+  const int DEBOUNCE_SETTLE_TICKS = 5 * DEBOUNCE_SAMPLE_TICKS;
+  const int MAX_REPORTED = 10;
+  const int INPUT_COMBINATIONS = 48;   //tank, air, soil, switch, flow rate (3)
+  const int TRACKS = 2 * ZONE_COUNT;
+  const uint8_t MAX_RUNNING[2] = {2, 1};        //timer and soil registry, the soil zones always compete
+  const uint32_t CHECK_STAGGER_MS = 1500;
+  const uint8_t PULSES[2] = {2, 3};            //cycle and soak in both registries
+  const unsigned long CHECK_SOAK_SEC = 60;
+  const int STATES = 5;
+
+  //the soil driven zones use pins the firmware leaves free
+  static_assert(ZONE_COUNT == 2, "the checker pin map is written for two zones");
+  const ZonePins WT_PINS[ZONE_COUNT] = { {SOIL1_IN, SOIL2_IN, SWITCH1_IN, RELAY1_OUT, FLOW1_IN, CHECK_PULSES_PER_L},
+                                         {SOIL3_IN, SOIL4_IN, SWITCH2_IN, RELAY2_OUT, FLOW2_IN, 0} };
+  const ZonePins SS_PINS[ZONE_COUNT] = { {20, 21, 13, 11, FLOW2_IN, 0},
+                                         {22, 23, 19, 12, FLOW2_IN, 0} };
+
+  enum FlowRate {FLOW_NOMINAL, FLOW_NONE, FLOW_HIGH};
+  enum Weather {WEATHER_DRY, WEATHER_HUMID, WEATHER_FROST};
+  const int WEATHER[3][2] = { {55, 21}, {90, 21}, {60, 2} };   //DHT11 humidity, temperature
+
+  uint32_t rng_;
+
+  uint32_t random32()
+  {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+
+  bool chance(const uint32_t one_in)
+  {
+    return random32() % one_in == 0;
+  }
+
+  struct PumpView
+  {
+    uint8_t state;
+    uint16_t cycles;
+    uint32_t intervalSec;
+    uint16_t today;   //Q8.8 litres
+  };
+
+  template<class Zones>
+  PumpView view(const Zones& zones, const uint8_t z)
+  {
+    Q24_8 today = zones.waterToday(z);
+    return { (uint8_t)zones.state(z), zones.cycles(z), (uint32_t)zones.timeBetweenTurnsOn(),
+             (uint16_t)(today.raw() > 0xFFFF ? 0xFFFF : today.raw()) };
+  }
+
+  bool running(const uint8_t state)
+  {
+    return state == onAuto || state == onMan;
+  }
+
+  //what the checker knows about a pump from the previous steps
+  struct Track
+  {
+    const char* name;
+    bool ss;
+    uint8_t zone;
+    int relay;
+    int switchPin;
+    bool metered;
+    bool soil;
+    PumpView last;
+    uint32_t startSec;
+    uint32_t stopSec;
+    uint8_t pulses;          //of the current automatic cycle
+    unsigned long transitions[STATES][STATES];
+    unsigned long visited[STATES][INPUT_COMBINATIONS];
+
+    Track(const char* name, const bool ss, const uint8_t zone, const int relay, const int switch_pin, const bool metered, const bool soil)
+      : name(name), ss(ss), zone(zone), relay(relay), switchPin(switch_pin), metered(metered), soil(soil),
+        last(), startSec(0), stopSec(0), pulses(0), transitions(), visited()
+    {
+    }
+  };
+
+  //input combination index: (tank | air << 1 | soil << 2 | switch << 3) * 3 + flow rate
+  //the flow rate matters only with a meter, the soil only with a soil sensor
+  bool reachable(const Track& t, const int combination)
+  {
+    return (t.metered || combination % 3 == FLOW_NOMINAL) && (t.soil || combination / 3 & 4);
+  }
+
+  //a combination the track has not seen in its current state, -1 - all seen
+  int unvisited(const Track& t)
+  {
+    int first = random32() % INPUT_COMBINATIONS;
+    for(int i = 0; i < INPUT_COMBINATIONS; ++i)
+    {
+      int c = (first + i) % INPUT_COMBINATIONS;
+      if(reachable(t, c) && !t.visited[t.last.state][c]) return c;
+    }
+    return -1;
+  }
+
+  WaterSensor* waterSensor_;
+  AirSensor* airSensor_;
+  unsigned long violations_;
+
+  void waterSensorWrapper()
+  {
+    waterSensor_->isrCallback();
+  }
+
+  void airSensorWrapper()
+  {
+    airSensor_->isrCallback();
+  }
+
+  //value is a duration or a volume that explains the violation, -1 - none
+  void violation(const char* subject, const char* what, const long value = -1)
+  {
+    if(++violations_ > MAX_REPORTED) return;
+    printf("VIOLATION at %lu s (millis %lu): %s: %s", (unsigned long)sysclock::nowSec(),
+           (unsigned long)sysclock::nowMs(), subject, what);
+    if(value >= 0) printf(" (%ld)", value);
+    printf("\n");
+  }
+
+  bool inTable(const uint8_t from, const uint8_t to)
+  {
+    return (from == idle && (to == onAuto || to == onMan)) ||
+           (from == onAuto && (to == off || to == idle || to == soak)) ||
+           (from == onMan && to == off) ||
+           (from == off && (to == onMan || to == idle)) ||
+           (from == soak && to != soak);
+  }
+}
+
+namespace sim
+{
+  int modelCheck(unsigned long steps, unsigned long seed)
+  {
+    rng_ = seed ? seed : 1;
+
+    //inputs are set before the sensors are built, the constructors latch them
+    bool tank = true, soil_dry[ZONE_COUNT][2], pressed[TRACKS];
+    int weather = WEATHER_DRY, flow = FLOW_NOMINAL, knob = 512;
+    sim::setPin(WATER_IN, LOW);
+    for(int z = 0; z < ZONE_COUNT; ++z)
+    {
+      soil_dry[z][0] = soil_dry[z][1] = true;
+      sim::setPin(SS_PINS[z].soil1, HIGH);
+      sim::setPin(SS_PINS[z].soil2, HIGH);
+      sim::setPin(WT_PINS[z].switchIn, HIGH);
+      sim::setPin(SS_PINS[z].switchIn, HIGH);
+      pressed[z] = pressed[ZONE_COUNT + z] = false;
+    }
+    sim::setAnalog(POT_IN, knob);
+    sim::attachDht11(AIR_IN);
+    sim::setDht11(WEATHER[weather][0], WEATHER[weather][1]);
+    sim::attachFlowMeter(RELAY1_OUT, FLOW1_IN, NOMINAL_HZ);
+
+    static WaterSensor water(WATER_IN, BUZZER_OUT, waterSensorWrapper);
+    static AirSensor air(AIR_IN, AIR_LED_OUT, digitalPinToInterrupt(AIR_IN), airSensorWrapper);
+    static ZoneRegistry<TIMER_DRIVEN> wt(WT_PINS, &water, &air, MAX_RUNNING[0], CHECK_STAGGER_MS);
+    static ZoneRegistry<SOIL_DRIVEN> ss(SS_PINS, &water, &air, MAX_RUNNING[1], CHECK_STAGGER_MS);
+    wt.setCycleMode(PULSES[0], CHECK_SOAK_SEC);
+    ss.setCycleMode(PULSES[1], CHECK_SOAK_SEC);
+    waterSensor_ = &water;
+    airSensor_ = &air;
+
+    //ten minutes before the millis() wrap
+    sim::advanceUs(((1ULL << 32) - 600000) * 1000 - sim::nowUs() % 1000);
+    sysclock::update();
+
+    //first weather reading and knob sample, the switches latch their idle level
+    bool air_expected = true;
+    bool air_read = false;
+    bool knob_sampled = false;
+    int switch_ticks[TRACKS];
+    for(int i = 0; i < TRACKS; ++i) switch_ticks[i] = DEBOUNCE_SETTLE_TICKS;
+    for(int i = 0; i < DEBOUNCE_SETTLE_TICKS; ++i) debounce::timerTick();
+
+    Track tracks[TRACKS] = {Track("pump 1 (WT, metered)", false, 0, RELAY1_OUT, SWITCH1_IN, true, false),
+                            Track("pump 2 (WT)", false, 1, RELAY2_OUT, SWITCH2_IN, false, false),
+                            Track("pump 1 (SS)", true, 0, SS_PINS[0].relayOut, SS_PINS[0].switchIn, false, true),
+                            Track("pump 2 (SS)", true, 1, SS_PINS[1].relayOut, SS_PINS[1].switchIn, false, true)};
+    for(Track& t : tracks) t.last = t.ss ? view(ss, t.zone) : view(wt, t.zone);
+
+    uint32_t tank_edge_ms = sysclock::nowMs() - WATER_SETTLE_MS;
+    uint32_t flow_change_sec = sysclock::nowSec();
+    uint64_t start_us = sim::nowUs();
+    uint32_t start_sec = sysclock::nowSec();
+    uint32_t last_ms = sysclock::nowMs();
+    uint32_t last_sec = start_sec;
+    unsigned long ms_wraps = 0;
+    unsigned long sec_wraps = 0;
+    uint32_t last_start_ms[2];
+    bool started[2] = {false, false};
+    unsigned long waits = 0;
+
+    auto wall_start = std::chrono::steady_clock::now();
+
+    for(unsigned long step = 0; step < steps; ++step)
+    {
+      //every other step steers the inputs to a combination one track has not seen in its state yet,
+      //the others are random - steadier during automatic cycles so that pulses and soaks run to their end
+      int target = -1;
+      const Track* target_track = nullptr;
+      if(chance(2))
+        for(const Track& t : tracks)
+          if((target = unvisited(t)) >= 0)
+          {
+            target_track = &t;
+            break;
+          }
+      int target_inputs = target / 3;
+      uint32_t flip = 4;
+      for(const Track& t : tracks)
+        if(t.last.state == onAuto || t.last.state == soak) flip = 24;
+      if(target_track ? tank != (bool)(target_inputs & 1) : chance(flip))
+      {
+        tank = !tank;
+        sim::setPin(WATER_IN, tank ? LOW : HIGH);
+        tank_edge_ms = millis();
+      }
+      for(int i = 0; i < TRACKS; ++i)
+      {
+        if(target_track == &tracks[i] ? pressed[i] == (bool)(target_inputs & 8) : !chance(flip)) continue;
+        pressed[i] = !pressed[i];
+        sim::setPin(tracks[i].switchPin, pressed[i] ? LOW : HIGH);
+        switch_ticks[i] = 0;
+      }
+      for(int z = 0; z < ZONE_COUNT; ++z)
+      {
+        bool targeted = target_track && target_track->soil && target_track->zone == z;
+        int wet_probe = targeted ? random32() % 2 : 0;
+        for(int p = 0; p < 2; ++p)
+        {
+          //wet soil needs one wet probe
+          bool dry = target_inputs & 4 || (soil_dry[z][0] && soil_dry[z][1] ? p != wet_probe : soil_dry[z][p]);
+          if(targeted ? soil_dry[z][p] == dry : !chance(flip)) continue;
+          soil_dry[z][p] = !soil_dry[z][p];
+          sim::setPin(p ? SS_PINS[z].soil2 : SS_PINS[z].soil1, soil_dry[z][p] ? HIGH : LOW);
+        }
+      }
+      if(target_track && target_track->metered ? flow != target % 3 : chance(8))
+      {
+        flow = target_track && target_track->metered ? target % 3 : random32() % 3;
+        sim::setFlowRate(FLOW1_IN, flow == FLOW_NOMINAL ? NOMINAL_HZ : flow == FLOW_HIGH ? 3 * NOMINAL_HZ : 0);
+        flow_change_sec = sysclock::nowSec();
+      }
+      if(!air_read || (target_track ? air_expected != (bool)(target_inputs & 2) : chance(8)))
+      {
+        weather = !target_track ? random32() % 3 : target_inputs & 2 ? (int)WEATHER_DRY : 1 + (int)(random32() % 2);
+        sim::setDht11(WEATHER[weather][0], WEATHER[weather][1]);
+        air_expected = weather == WEATHER_DRY;
+
+        //the air task: start the acquisition, collect it on a later pass
+        air.readSensor();
+        for(int i = 0; i < 100 && air.acquiring(); ++i) sim::advanceUs(1000);
+        air.readSensor();
+        air_read = true;
+      }
+      if(chance(16) || !knob_sampled)
+      {
+        int choice = random32() % 4;
+        knob = choice == 0 ? 0 : choice == 1 ? 1023 : (int)(random32() % 1024);
+        sim::setAnalog(POT_IN, knob);
+        adc::startRound();
+        sim::advanceUs(ADC_OVERSAMPLING * ADC_MAX_CHANNELS * 200UL);
+        knob_sampled = true;
+      }
+
+      //time jump, a running pump is controlled at least once a second
+      uint32_t r = random32() % 100;
+      uint64_t jump_ms = r < 40 ? 1 + random32() % 200 :
+                         r < 70 ? 1000 :
+                         r < 85 ? 60000 + random32() % 1000 :
+                         r < 95 ? 3600000 :
+                         86400000 + random32() % 3600000;
+      for(const Track& t : tracks)
+        if(running(t.last.state) && jump_ms > RUNNING_JUMP_MS) jump_ms = RUNNING_JUMP_MS;
+      //long enough for the tank and the switches to settle
+      if(target_track) jump_ms = RUNNING_JUMP_MS;
+      sim::advanceUs(jump_ms * 1000);
+
+      //the sensor tasks and one control tick
+      //settled switches leave the debouncer idle, its ticks are skipped then
+      int ticks = jump_ms * 1000 / 1024 < DEBOUNCE_SETTLE_TICKS ? jump_ms * 1000 / 1024 : DEBOUNCE_SETTLE_TICKS;
+      bool settling = false;
+      for(int i = 0; i < TRACKS; ++i) settling |= switch_ticks[i] < DEBOUNCE_SETTLE_TICKS;
+      if(settling) for(int i = 0; i < ticks; ++i) debounce::timerTick();
+      for(int i = 0; i < TRACKS; ++i) switch_ticks[i] += ticks;
+
+      sysclock::update();
+      fastio::snapshot();
+      water.readSensor();
+      ss.readSoil();
+      wt.controlPumps();
+      ss.controlPumps();
+
+      uint32_t now_sec = sysclock::nowSec();
+      uint32_t now_ms = sysclock::nowMs();
+      if(now_ms < last_ms) ++ms_wraps;
+      if(now_sec < last_sec) ++sec_wraps;
+      last_ms = now_ms;
+      last_sec = now_sec;
+
+      //sensors against the inputs
+      bool tank_settled = (int32_t)(now_ms - tank_edge_ms) >= WATER_SETTLE_MS;
+      if(tank_settled && water.shouldWater() != tank) violation("sensors", "water sensor disagrees with the tank");
+      if(air.shouldWater() != air_expected) violation("sensors", "air sensor disagrees with the weather");
+      for(int z = 0; z < ZONE_COUNT; ++z)
+        if(ss.soilWantsWater(z) != (soil_dry[z][0] && soil_dry[z][1])) violation("sensors", "soil sensor disagrees with the soil");
+
+      //clock: seconds follow virtual time over both wraps
+      uint32_t elapsed_sec = (uint32_t)((sim::nowUs() - start_us) / 1000000);
+      uint32_t drift = now_sec - start_sec - elapsed_sec;
+      if(drift != 0 && drift != 1 && drift != 0xFFFFFFFF) violation("sysclock", "seconds drifted from virtual time");
+
+      //the arbiter: supply limit, manual requests first, nobody waits for a free slot
+      int running_count[2] = {0, 0};
+      bool manual_waits[2] = {false, false};
+      for(const Track& t : tracks)
+      {
+        uint8_t state = t.ss ? ss.state(t.zone) : wt.state(t.zone);
+        bool waiting = t.ss ? ss.waiting(t.zone) : wt.waiting(t.zone);
+        bool switch_on = t.ss ? ss.switchOn(t.zone) : wt.switchOn(t.zone);
+        running_count[t.ss] += running(state);
+        if(waiting && (state == off || state == soak) && switch_on) manual_waits[t.ss] = true;
+      }
+      //the evapotranspiration estimate and the daily volume it sets, the DHT11 range (50 degC) gives at most 1.66 Ra
+      if(et::dailyMm() > Q8_8::fromInt(2 * ET_RADIATION_MM)) violation("et", "estimate out of range [Q8.8 mm]", et::dailyMm().raw());
+      if(et::dailyMm() < Q8_8()) violation("et", "negative estimate [Q8.8 mm]", et::dailyMm().raw());
+      if(wt.waterPerDay() > Q24_8::fromInt(_MAX_WATER_PER_DAY_L)) violation("timer registry", "daily volume above the limit");
+
+      for(int r = 0; r < 2; ++r)
+        if(running_count[r] > MAX_RUNNING[r]) violation(r ? "soil registry" : "timer registry", "too many pumps running", running_count[r]);
+
+      for(int i = 0; i < TRACKS; ++i)
+      {
+        Track& t = tracks[i];
+        PumpView v = t.ss ? view(ss, t.zone) : view(wt, t.zone);
+        bool switch_on = t.ss ? ss.switchOn(t.zone) : wt.switchOn(t.zone);
+        bool relay_on = digitalRead(t.relay) == LOW;
+        bool soil_wants = !t.soil || ss.soilWantsWater(t.zone);
+        int inputs = tank | air.shouldWater() << 1 | soil_wants << 2 | switch_on << 3;
+        ++t.visited[t.last.state][inputs * 3 + (t.metered ? flow : 0)];
+
+        if(switch_ticks[i] >= DEBOUNCE_SETTLE_TICKS && switch_on != pressed[i])
+          violation(t.name, "debounced switch disagrees with the switch");
+
+        if(v.state != t.last.state)
+        {
+          ++t.transitions[t.last.state][v.state];
+          if(!inTable(t.last.state, v.state)) violation(t.name, "transition outside of the table");
+          if(running(v.state) && !running(t.last.state))
+          {
+            if(v.state == onAuto && started[t.ss] && now_ms - last_start_ms[t.ss] < CHECK_STAGGER_MS)
+              violation(t.name, "start not staggered [ms]", now_ms - last_start_ms[t.ss]);
+            if(v.state == onAuto && manual_waits[t.ss]) violation(t.name, "automatic start ahead of a waiting manual run");
+            started[t.ss] = true;
+            last_start_ms[t.ss] = now_ms;
+          }
+          if(running(v.state)) t.startSec = now_sec;
+          if(running(t.last.state)) t.stopSec = now_sec;
+        }
+
+        if(relay_on != running(v.state)) violation(t.name, "relay does not follow the state");
+        if(relay_on && !tank && tank_settled) violation(t.name, "pumping from an empty tank");
+        if(v.state == onMan && !switch_on) violation(t.name, "manual run without the switch");
+
+        if(v.state == onAuto && t.last.state == soak)
+        {
+          if(!water.shouldWater() || !soil_wants) violation(t.name, "next pulse against a sensor");
+          if(now_sec - t.stopSec < CHECK_SOAK_SEC) violation(t.name, "soak cut short [s]", now_sec - t.stopSec);
+          if(++t.pulses > PULSES[t.ss]) violation(t.name, "too many pulses in a cycle", t.pulses);
+          if(v.cycles != t.last.cycles) violation(t.name, "pulse counted as a cycle");
+        }
+        else if(v.state == onAuto && t.last.state != onAuto)
+        {
+          t.pulses = 1;
+          if(!water.shouldWater() || !air.shouldWater() || !soil_wants) violation(t.name, "automatic start against a sensor");
+          if(v.cycles != (uint16_t)(t.last.cycles + 1)) violation(t.name, "automatic start not counted");
+          //the cycle is charged up front - with it the day must stay within the volume the weather and the knob ask for
+          if(!t.ss && v.today > wt.waterPerDay().raw()) violation(t.name, "daily volume exceeded [Q8.8 l]", v.today);
+        }
+        else if(v.cycles != t.last.cycles) violation(t.name, "cycle counted without an automatic start");
+
+        if(v.state == soak && !soil_wants) violation(t.name, "soaking in wet soil");
+        if(t.last.state == off && v.state == idle && now_sec - t.stopSec <= v.intervalSec)
+          violation(t.name, "rest period cut short [s]", now_sec - t.stopSec);
+
+        uint32_t run_sec = now_sec - t.startSec;
+        uint32_t pulse_sec = _DELAY_CONSTANT_SEC + (MAX_WATERING_TIME_SEC - _DELAY_CONSTANT_SEC) / PULSES[t.ss];
+        uint32_t auto_limit = (t.metered ? 2 : 1) * pulse_sec + 2;
+        if(v.state == onAuto && run_sec > auto_limit) violation(t.name, "pulse too long [s]", run_sec);
+        if(t.metered && running(v.state))
+        {
+          uint32_t since = now_sec - flow_change_sec < run_sec ? now_sec - flow_change_sec : run_sec;
+          if(flow == FLOW_NONE && since > _NO_FLOW_SEC + 2) violation(t.name, "dry run not detected [s]", since);
+          if(flow == FLOW_HIGH && since == run_sec && run_sec > 5) violation(t.name, "burst not detected [s]", run_sec);
+        }
+        t.last = v;
+      }
+
+      //after the starts of this step are booked, the stagger holds back automatic starts only
+      for(const Track& t : tracks)
+      {
+        if(!(t.ss ? ss.waiting(t.zone) : wt.waiting(t.zone))) continue;
+        ++waits;
+        bool stagger_over = !started[t.ss] || now_ms - last_start_ms[t.ss] >= CHECK_STAGGER_MS;
+        //a pressed switch asks for a manual run unless an idle zone qualifies for an automatic one
+        uint8_t state = t.ss ? ss.state(t.zone) : wt.state(t.zone);
+        bool soil_wants = !t.soil || ss.soilWantsWater(t.zone);
+        bool manual = (t.ss ? ss.switchOn(t.zone) : wt.switchOn(t.zone)) && (state != idle || !air.shouldWater() || !soil_wants);
+        if(running_count[t.ss] < MAX_RUNNING[t.ss] && (stagger_over || manual)) violation(t.name, "waiting with a free start slot");
+      }
+    }
+
+    double wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    printf("steps:               %lu (seed %lu)\n", steps, seed);
+    printf("host wall time:      %.3f s\n", wall_sec);
+    printf("host step rate:      %.0f /s\n", steps / wall_sec);
+    printf("virtual time:        %.1f days\n", (sim::nowUs() - start_us) / 86400e6);
+    printf("millis() wraps:      %lu\n", ms_wraps);
+    printf("seconds wraps:       %lu\n", sec_wraps);
+    printf("arbiter waits:       %lu zone steps\n", waits);
+
+    const char* STATE[STATES] = {"idle", "onAuto", "onMan", "off", "soak"};
+    bool covered = true;
+    for(const Track& t : tracks)
+    {
+      int visited = 0;
+      int combinations = 0;
+      for(int s = 0; s < STATES; ++s)
+        for(int c = 0; c < INPUT_COMBINATIONS; ++c)
+          if(reachable(t, c))
+          {
+            ++combinations;
+            visited += t.visited[s][c] != 0;
+          }
+      covered &= visited == combinations;
+      printf("%s: %d of %d state/input combinations visited, transitions:", t.name, visited, combinations);
+      for(int from = 0; from < STATES; ++from)
+        for(int to = 0; to < STATES; ++to)
+          if(inTable(from, to)) printf(" %s->%s %lu", STATE[from], STATE[to], t.transitions[from][to]);
+      printf("\n");
+    }
+    printf("violations:          %lu\n", violations_);
+    if(!covered) printf("COVERAGE INCOMPLETE: not every state/input combination was visited, run more steps\n");
+    return violations_ || !covered ? 1 : 0;
+  }
+}
+
+#else
+namespace sim
+{
+  int modelCheck(unsigned long, unsigned long)
+  {
+    printf("the model checker is written for the Leonardo pin set, build the simulation without -D__AVR_ATmega2560__\n");
+    return 1;
+  }
+}
+#endif
@@ -0,0 +1,13 @@
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+//model checker of the pump and sensor logic (sim/gws_sim --check)
+//drives its own zones through random input combinations and time jumps on the virtual-time HAL, every other step
+//steers the inputs to a state/input combination not visited yet, and checks the safety invariants after every step
+//returns non-zero when one is violated or a combination was never visited
+namespace sim
+{
+  int modelCheck(unsigned long steps, unsigned long seed);
+}
+
+#endif
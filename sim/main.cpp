@@ -0,0 +1,556 @@
+//host simulation of the watering controller
+//runs the unmodified sketch (setup()/loop() plus sensors, pumps and idDHT11) on the virtual-time HAL
+//
+//build (from the repository root):
+//  g++ -std=c++11 -O2 -DARDUINO=100 -Isim -I. -x c++ GardenWateringSystem.ino -x none *.cpp sim/*.cpp -o sim/gws_sim
+//add -D__AVR_ATmega2560__ for the Arduino Mega pin map and its eight zones (config.h), --check needs the Leonardo
+//
+//usage: sim/gws_sim [-d seconds] [-t start_sec] [-c loop_cost_us] [-v] [-o capture] [-e eeprom] [--season days [-w weather]]
+//                   [--pulses n [--soak seconds]] [script]
+//       sim/gws_sim --dewpoint
+//       sim/gws_sim --decode capture
+//       sim/gws_sim --check [steps] [seed]
+//  -d  virtual time to simulate (default 600 s)
+//  -t  virtual time at power on, e.g. -t 4294900 boots a minute before the millis() wrap
+//  -c  virtual cost of one loop() pass besides blocking core calls (default 175 us, ~2500 passes/s with two ADC reads)
+//  -v  echo Serial output
+//  -o  write everything sent over Serial to a file
+//  -e  EEPROM image loaded at power on (blank if missing) and written back at the end,
+//      two runs with the same image simulate a reset
+//  --season  run a growing season of the given length against the soil and weather model of sim/season.cpp,
+//            wakeups that change nothing are skipped (see sim::setFastForward) - 120 days take about 2 s,
+//            reports water, pump starts and dry hours per zone
+//  -w  hourly weather CSV for --season (default: synthetic summer weather)
+//  --pulses  automatic cycles as n pulses (cycle and soak) instead of PULSES_PER_CYCLE, --soak overrides SOAK_SEC,
+//            run a --season with --pulses 1 and with more to compare how much of the water soaks in
+//  --decode  print the binary telemetry frames of a capture (or of a real serial log) as text
+//  --dewpoint  compare the dew point implementations of idDHT11 over the whole DHT11 range
+//  --check  model check the pumps and sensors with random inputs and time jumps (default 1000000 steps, seed 1),
+//           see sim/check.cpp for the invariants, exits with 1 on a violation or when a state/input
+//           combination was never visited (about 200000 steps cover all of them)
+//
+//script lines (# starts a comment), applied when virtual time reaches t_sec:
+//  <t_sec> pin <pin> <0|1>        drive a digital input
+//  <t_sec> adc <pin> <0..1023>    set an analog input
+//  <t_sec> dht <humidity> <temp>  set what the DHT11 reports
+//  <t_sec> dht_bad <0|1>          corrupt the DHT11 checksum
+//  <t_sec> flow <pin> <hz>        pulse rate of a flow meter while its pump runs (0 - dry run)
+//  <t_sec> rx <byte>              send a byte to the firmware over Serial, e.g. 104 ('h') dumps the sensor history
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "Arduino.h"
+#include "sim.h"
+#include "check.h"
+#include "season.h"
+#include "config.h"
+#include "idDHT11.h"
+#include "telemetry.h"
+#include "profiler.h"
+#include "watchdog.h"
+#include "pumps.h"
+#include "topology.h"
+#include "history.h"
+
+//the firmware's zones, the cycle mode can be overridden from the command line
+extern SystemZones zones;
+
+void setup();
+void loop();
+
+namespace
+{
+  struct Step
+  {
+    double t;
+    char cmd[16];
+    int a;
+    int b;
+  };
+
+  bool loadScript(const char* path, std::vector<Step>& script)
+  {
+    FILE* f = fopen(path, "r");
+    if(!f) return false;
+
+    char line[128];
+    while(fgets(line, sizeof(line), f))
+    {
+      Step s = {};
+      if(line[0] == '#') continue;
+      if(sscanf(line, "%lf %15s %d %d", &s.t, s.cmd, &s.a, &s.b) >= 3) script.push_back(s);
+    }
+    fclose(f);
+
+    std::stable_sort(script.begin(), script.end(), [](const Step& l, const Step& r) { return l.t < r.t; });
+    return true;
+  }
+
+  //tank full, knob in the middle, mild weather
+  void defaultScript(std::vector<Step>& script)
+  {
+    script.push_back({0, "pin", WATER_IN, 0});
+    script.push_back({0, "adc", POT_IN, 512});
+    script.push_back({0, "dht", 55, 21});
+  }
+
+  idDHT11* probe;
+  void probeIsr() { probe->isrCallback(); }
+
+  //every reading the DHT11 can report (0..50 degC, 20..90 %RH) goes through the simulated
+  //waveform, the results are compared with the NOAA reference getDewPointSlow()
+  int dewPointCheck()
+  {
+    const int REPEAT = 2000;
+    double max_fixed = 0, max_fast = 0;
+    int fixed_at[2] = {0, 0};
+    double ns[3] = {0, 0, 0};
+    volatile double sink = 0;
+
+    sim::attachDht11(AIR_IN);
+    idDHT11 dht(AIR_IN, digitalPinToInterrupt(AIR_IN), probeIsr);
+    probe = &dht;
+
+    for(int t = 0; t <= 50; ++t)
+    {
+      for(int h = 20; h <= 90; ++h)
+      {
+        sim::setDht11(h, t);
+        if(dht.acquireAndWait() != IDDHTLIB_OK)
+        {
+          fprintf(stderr, "sim: DHT11 read failed at %d %%RH %d degC\n", h, t);
+          return 1;
+        }
+
+        double slow = dht.getDewPointSlow();
+        double fixed = dht.getDewPointFixed() / (double)(1 << IDDHT11_FRAC_BITS);
+        if(fabs(fixed - slow) > max_fixed)
+        {
+          max_fixed = fabs(fixed - slow);
+          fixed_at[0] = h;
+          fixed_at[1] = t;
+        }
+        if(fabs(dht.getDewPoint() - slow) > max_fast) max_fast = fabs(dht.getDewPoint() - slow);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for(int i = 0; i < REPEAT; ++i) sink = sink + dht.getDewPointFixed();
+        auto t1 = std::chrono::steady_clock::now();
+        for(int i = 0; i < REPEAT; ++i) sink = sink + dht.getDewPoint();
+        auto t2 = std::chrono::steady_clock::now();
+        for(int i = 0; i < REPEAT; ++i) sink = sink + dht.getDewPointSlow();
+        auto t3 = std::chrono::steady_clock::now();
+        ns[0] += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        ns[1] += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        ns[2] += std::chrono::duration<double, std::nano>(t3 - t2).count();
+      }
+    }
+
+    const double calls = 51.0 * 71 * REPEAT;
+    printf("max |getDewPointFixed - getDewPointSlow|: %.3f degC (at %d %%RH, %d degC)\n", max_fixed, fixed_at[0], fixed_at[1]);
+    printf("max |getDewPoint - getDewPointSlow|:      %.3f degC\n", max_fast);
+    printf("host time per call: fixed %.1f ns, getDewPoint %.1f ns, getDewPointSlow %.1f ns\n",
+           ns[0] / calls, ns[1] / calls, ns[2] / calls);
+    return 0;
+  }
+
+  struct Cursor
+  {
+    const uint8_t* p;
+    int left;
+    bool ok() const { return left >= 0; }
+    unsigned long take(int n)
+    {
+      unsigned long v = 0;
+      left -= n;
+      if(left < 0) return 0;
+      for(int i = 0; i < n; ++i) v |= (unsigned long)*p++ << (8 * i);
+      return v;
+    }
+  };
+
+  const char* PUMP_STATE[] = {"idle", "on (auto)", "on (manual)", "off", "soak"};
+  const unsigned long PUMP_STATES = sizeof(PUMP_STATE)/sizeof(PUMP_STATE[0]);
+
+  void printStatus(Cursor c)
+  {
+    unsigned long ts = c.take(4);
+    unsigned long dropped = c.take(2);
+    double temp = (int16_t)c.take(2) / 256.0;
+    double hum = (int16_t)c.take(2) / 256.0;
+    double dew = (int16_t)c.take(2) / 256.0;
+    unsigned long air = c.take(1);
+    double et0 = (int16_t)c.take(2) / 256.0;
+    unsigned long et_hours = c.take(1);
+    unsigned long water = c.take(1);
+    c.take(1);   //first zone of the chunk, the pump ids tell it
+    unsigned long zones = c.take(1);
+
+    printf("[%lu s] air %.2f degC %.2f %%RH dew point %.2f degC%s%s, ET0 %.2f mm/day (%lu h), %s\n", ts, temp, hum, dew,
+           air & 1 ? ", watering allowed" : "", air & 2 ? ", SENSOR ERROR" : "", et0, et_hours, water ? "tank ok" : "TANK EMPTY");
+    if(dropped) printf("  %lu frames dropped so far\n", dropped);
+    for(unsigned long z = 0; z < zones && c.ok(); ++z)
+    {
+      unsigned long sw = c.take(1);
+      unsigned long soil = c.take(1);
+      unsigned long id = c.take(1);
+      unsigned long state = c.take(1);
+      unsigned long cycles = c.take(2);
+      unsigned long interval = c.take(4);
+      unsigned long faults = c.take(1);
+      double today = c.take(2) / 256.0;
+      if(!c.ok()) break;
+
+      printf("  pump %lu: %s, %lu cycles, min interval %.1f min, %.2f l today%s%s%s%s", id, state < PUMP_STATES ? PUMP_STATE[state] : "?",
+             cycles, interval / 60.0, today, sw & 1 ? ", switch on" : "", sw & 2 ? ", waiting" : "",
+             faults & 1 ? ", DRY RUN" : "", faults & 2 ? ", BURST" : "");
+      if(soil & 0x80) printf(", soil %s/%s%s", soil & 2 ? "dry" : "wet", soil & 4 ? "dry" : "wet", soil & 1 ? " -> water" : "");
+      printf("\n");
+    }
+    if(!c.ok()) printf("  (truncated record)\n");
+  }
+
+  void printLatency(Cursor c)
+  {
+    unsigned long stage = c.take(1);
+    unsigned long count = c.take(2);
+    unsigned long min = c.take(2);
+    unsigned long max = c.take(2);
+    unsigned long mean = c.take(2);
+
+    printf("  stage %lu: %lu runs, min %.1f us, mean %.1f us, max %.1f us, histogram", stage, count, min / 2.0, mean / 2.0, max / 2.0);
+    for(int i = 0; i < PROFILER_BUCKETS && c.ok(); ++i) printf(" %lu", c.take(2));
+    printf("\n");
+    if(!c.ok()) printf("  (truncated record)\n");
+  }
+
+  void printReset(Cursor c)
+  {
+    unsigned long stage = c.take(1);
+    unsigned long stage_ms = c.take(4);
+    unsigned long pc = c.take(2);
+    unsigned long resets = c.take(1);
+    if(!c.ok()) printf("watchdog reset (truncated record)\n");
+    else printf("watchdog reset #%lu: stage 0x%02lx entered at %lu ms, pc 0x%04lx\n", resets, stage, stage_ms, pc);
+  }
+
+  const char* GUARD_NAME[] = {"tank", "no_tank", "air", "soil_dry", "soil_wet", "budget",
+                              "switch", "no_switch", "cycle_done", "flow_fault", "rest_over", "grant",
+                              "pulse_done", "soak_over"};
+
+  void printTrace(Cursor c)
+  {
+    unsigned long count = c.take(1);
+    for(unsigned long i = 0; i < count && c.ok(); ++i)
+    {
+      unsigned long ts = c.take(4);
+      unsigned long id = c.take(1);
+      unsigned long from = c.take(1);
+      unsigned long to = c.take(1);
+      unsigned long guards = c.take(2);
+      if(!c.ok()) break;
+
+      printf("  [%lu s] pump %lu: %s -> %s,", ts, id, from < PUMP_STATES ? PUMP_STATE[from] : "?", to < PUMP_STATES ? PUMP_STATE[to] : "?");
+      for(unsigned g = 0; g < sizeof(GUARD_NAME)/sizeof(GUARD_NAME[0]); ++g)
+        if(guards & (1u << g)) printf(" %s", GUARD_NAME[g]);
+      printf("\n");
+    }
+    if(!c.ok()) printf("  (truncated record)\n");
+  }
+
+  //the dump arrives in chunks, it is decoded once complete (layout in history.h)
+  std::vector<uint8_t> historyDump;
+
+  unsigned long historyVarint(Cursor& c)
+  {
+    unsigned long value = 0;
+    for(int shift = 0; c.ok(); shift += 7)
+    {
+      unsigned long b = c.take(1);
+      value |= (b & 0x7F) << shift;
+      if(!(b & 0x80)) break;
+    }
+    return value;
+  }
+
+  long historyZigzag(Cursor& c)
+  {
+    unsigned long v = historyVarint(c);
+    return (long)(v >> 1) ^ -(long)(v & 1);
+  }
+
+  void printHistorySample(unsigned long ts, int temp, int hum, unsigned long flags, int zones, unsigned long repeats)
+  {
+    printf("  [%lu s] %.1f degC %d %%RH, %s%s", ts, temp / 2.0, hum, flags & 1 ? "tank ok" : "TANK EMPTY", flags & 2 ? ", AIR SENSOR ERROR" : "");
+    for(int z = 0; z < zones; ++z)
+    {
+      bool ran = flags >> (HISTORY_PUMPS_SHIFT + z) & 1;
+      bool dry1 = flags >> (2 + zones + z) & 1;
+      bool dry2 = flags >> (2 + 2 * zones + z) & 1;
+      if(ran || dry1 || dry2) printf(", zone %d:%s%s%s", z + 1, ran ? " pumped" : "", dry1 ? " probe 1 dry" : "", dry2 ? " probe 2 dry" : "");
+    }
+    if(repeats) printf(" (%lu more samples the same)", repeats);
+    printf("\n");
+  }
+
+  void printHistory(Cursor c)
+  {
+    unsigned long offset = c.take(2);
+    unsigned long total = c.take(2);
+    if(!c.ok() || offset != historyDump.size())
+    {
+      printf("history chunk at %lu out of order\n", offset);
+      historyDump.clear();
+      return;
+    }
+    while(c.left > 0) historyDump.push_back(c.take(1));
+    if(historyDump.size() < total) return;
+
+    Cursor d = {historyDump.data(), (int)historyDump.size()};
+    unsigned long newest = d.take(4);
+    unsigned long period = d.take(2);
+    unsigned long count = d.take(2);
+    int zones = d.take(1);
+    int temp = (int8_t)d.take(1);
+    int hum = d.take(1);
+    unsigned long flags = d.take(4);
+    printf("history: %lu samples every %lu s in %lu bytes\n", count, period, total - 15);
+
+    //a sample is printed once the next change shows how often it repeated
+    unsigned long index = 0, repeats = 0;
+    while(d.ok() && d.left > 0)
+    {
+      unsigned long header = d.take(1);
+      if(header & 0x80)
+      {
+        repeats += (header & 0x7F) + 1;
+        continue;
+      }
+      printHistorySample(newest - (count - 1 - index) * period, temp, hum, flags, zones, repeats);
+      index += repeats + 1;
+      repeats = 0;
+      if(header & 0x40)
+      {
+        flags ^= 1UL << (header & 0x1F);
+        continue;
+      }
+      unsigned long t = header >> 2 & 15;
+      temp += t == 15 ? historyZigzag(d) : (long)(t >> 1) ^ -(long)(t & 1);
+      if(header & 1) hum += historyZigzag(d);
+      if(header & 2) flags ^= historyVarint(d);
+    }
+    if(count) printHistorySample(newest - (count - 1 - index) * period, temp, hum, flags, zones, repeats);
+    if(!d.ok()) printf("  (truncated dump)\n");
+    historyDump.clear();
+  }
+
+  int decode(const char* path)
+  {
+    FILE* f = fopen(path, "rb");
+    if(!f)
+    {
+      fprintf(stderr, "sim: cannot open %s\n", path);
+      return 1;
+    }
+
+    uint8_t frame[256];
+    uint8_t record[256];
+    int size = 0, c;
+    unsigned long good = 0, bad = 0;
+
+    while((c = fgetc(f)) != EOF)
+    {
+      if(c)
+      {
+        if(size < (int)sizeof(frame)) frame[size++] = c;
+        continue;
+      }
+
+      uint8_t n = size ? telemetry::cobsDecode(frame, size, record) : 0;
+      size = 0;
+      if(n < 3 || telemetry::crc16(record, n - 2) != (record[n-2] | record[n-1] << 8))
+      {
+        ++bad;
+        continue;
+      }
+
+      ++good;
+      Cursor cursor = {record + 1, n - 3};
+      if(record[0] == telemetry::RECORD_STATUS) printStatus(cursor);
+      else if(record[0] == telemetry::RECORD_LATENCY) printLatency(cursor);
+      else if(record[0] == telemetry::RECORD_RESET) printReset(cursor);
+      else if(record[0] == telemetry::RECORD_TRACE) printTrace(cursor);
+      else if(record[0] == telemetry::RECORD_HISTORY) printHistory(cursor);
+      else printf("record type %u, %d bytes\n", record[0], n - 3);
+    }
+    fclose(f);
+    printf("%lu frames, %lu rejected\n", good, bad);
+    return 0;
+  }
+
+  void apply(const Step& s)
+  {
+    if(!strcmp(s.cmd, "pin")) sim::setPin(s.a, s.b);
+    else if(!strcmp(s.cmd, "adc")) sim::setAnalog(s.a, s.b);
+    else if(!strcmp(s.cmd, "dht")) sim::setDht11(s.a, s.b);
+    else if(!strcmp(s.cmd, "dht_bad")) sim::setDht11BadChecksum(s.a);
+    else if(!strcmp(s.cmd, "flow")) sim::setFlowRate(s.a, s.b);
+    else if(!strcmp(s.cmd, "rx")) sim::serialReceive(s.a);
+    else fprintf(stderr, "sim: unknown script command '%s'\n", s.cmd);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  double duration_sec = 600;
+  double start_sec = 0;
+  unsigned long loop_cost_us = 175;
+  const char* script_path = nullptr;
+  FILE* capture = nullptr;
+  const char* eeprom_path = nullptr;
+  double season_days = 0;
+  const char* weather_path = nullptr;
+  int pulses = PULSES_PER_CYCLE;
+  unsigned long soak_sec = SOAK_SEC;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    if(!strcmp(argv[i], "-d") && i+1 < argc) duration_sec = atof(argv[++i]);
+    else if(!strcmp(argv[i], "-t") && i+1 < argc) start_sec = atof(argv[++i]);
+    else if(!strcmp(argv[i], "-c") && i+1 < argc) loop_cost_us = strtoul(argv[++i], nullptr, 10);
+    else if(!strcmp(argv[i], "-v")) sim::setSerialEcho(true);
+    else if(!strcmp(argv[i], "-e") && i+1 < argc) eeprom_path = argv[++i];
+    else if(!strcmp(argv[i], "--season") && i+1 < argc) season_days = atof(argv[++i]);
+    else if(!strcmp(argv[i], "-w") && i+1 < argc) weather_path = argv[++i];
+    else if(!strcmp(argv[i], "--pulses") && i+1 < argc) pulses = atoi(argv[++i]);
+    else if(!strcmp(argv[i], "--soak") && i+1 < argc) soak_sec = strtoul(argv[++i], nullptr, 10);
+    else if(!strcmp(argv[i], "--dewpoint")) return dewPointCheck();
+    else if(!strcmp(argv[i], "--decode") && i+1 < argc) return decode(argv[++i]);
+    else if(!strcmp(argv[i], "--check"))
+    {
+      unsigned long steps = i+1 < argc ? strtoul(argv[i+1], nullptr, 10) : 0;
+      unsigned long seed = i+2 < argc ? strtoul(argv[i+2], nullptr, 10) : 0;
+      return sim::modelCheck(steps ? steps : 1000000, seed ? seed : 1);
+    }
+    else if(!strcmp(argv[i], "-o") && i+1 < argc)
+    {
+      capture = fopen(argv[++i], "wb");
+      if(!capture)
+      {
+        fprintf(stderr, "sim: cannot create %s\n", argv[i]);
+        return 1;
+      }
+      sim::setSerialCapture(capture);
+    }
+    else script_path = argv[i];
+  }
+
+  std::vector<Step> script;
+  if(script_path && !loadScript(script_path, script))
+  {
+    fprintf(stderr, "sim: cannot open %s\n", script_path);
+    return 1;
+  }
+  if(!script_path) defaultScript(script);
+
+  FILE* eeprom = eeprom_path ? fopen(eeprom_path, "rb") : nullptr;
+  sim::loadEeprom(eeprom);
+  if(eeprom) fclose(eeprom);
+
+  zones.setCycleMode(pulses, soak_sec);
+  sim::attachDht11(AIR_IN);
+  //meters deliver the nominal flow unless the script says otherwise
+  for(const ZonePins& zone : ZONE_PINS)
+    if(zone.flowPulsesPerL)
+      sim::attachFlowMeter(zone.relayOut, zone.flowIn, (_WATER_L_PER_SEC * (long)zone.flowPulsesPerL).toInt());
+  sim::advanceUs(start_sec * 1e6);
+  if(season_days)
+  {
+    duration_sec = season_days * 86400;
+    if(!sim::seasonStart(weather_path)) return 1;
+  }
+
+  size_t next = 0;
+  uint64_t end_us = (start_sec + duration_sec) * 1e6;
+  unsigned long iterations = 0;
+  uint64_t max_latency_us = 0;
+  uint64_t max_latency_at_us = 0;
+  uint64_t max_quiet_latency_us = 0;   //passes that did not print anything
+
+  auto wall_start = std::chrono::steady_clock::now();
+
+  setup();
+  while(sim::nowUs() < end_us)
+  {
+    while(next < script.size() && (start_sec + script[next].t) * 1e6 <= sim::nowUs())
+      apply(script[next++]);
+
+    uint64_t start_us = sim::nowUs();
+    uint64_t start_sleep_us = sim::stats().sleepUs;
+    unsigned long serial_bytes = sim::stats().serialBytes;
+    loop();
+    sim::advanceUs(loop_cost_us);
+    ++iterations;
+    if(season_days)
+    {
+      sim::seasonUpdate();
+      sim::setFastForward(sim::seasonNextStepUs());
+    }
+
+    //time asleep in the pass is not latency, an interrupt ends the sleep
+    uint64_t latency_us = sim::nowUs() - start_us - (sim::stats().sleepUs - start_sleep_us);
+    if(latency_us > max_latency_us)
+    {
+      max_latency_us = latency_us;
+      max_latency_at_us = start_us;
+    }
+    if(sim::stats().serialBytes == serial_bytes && latency_us > max_quiet_latency_us)
+      max_quiet_latency_us = latency_us;
+  }
+
+  double wall_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  const sim::Stats& st = sim::stats();
+
+  printf("virtual time:        %.1f s\n", duration_sec);
+  printf("loop iterations:     %lu\n", iterations);
+  printf("virtual loop rate:   %.1f /s\n", iterations / duration_sec);
+  printf("max loop latency:    %.3f ms (at %.3f s)\n", max_latency_us / 1e3, max_latency_at_us / 1e6 - start_sec);
+  printf("max latency w/o tx:  %.3f ms\n", max_quiet_latency_us / 1e3);
+  printf("asleep:              %.1f %% of the time\n", 100.0 * st.sleepUs / (duration_sec * 1e6));
+  printf("host wall time:      %.3f s\n", wall_sec);
+  printf("host loop rate:      %.0f /s\n", iterations / wall_sec);
+  printf("digitalRead calls:   %lu\n", st.digitalReads);
+  printf("digitalWrite calls:  %lu\n", st.digitalWrites);
+  printf("port reads:          %lu\n", st.portReads);
+  printf("port writes:         %lu\n", st.portWrites);
+  printf("digital I/O cycles:  %.2f per pass (estimated)\n",
+         (double)(st.digitalReads * sim::DIGITAL_READ_CYCLES + st.digitalWrites * sim::DIGITAL_WRITE_CYCLES +
+                  st.portReads * sim::PORT_READ_CYCLES + st.portWrites * sim::PORT_WRITE_CYCLES) / iterations);
+  printf("analogRead calls:    %lu\n", st.analogReads);
+  printf("adc conversions:     %lu\n", st.adcConversions);
+  printf("millis/micros calls: %lu\n", st.clockReads);
+  printf("serial bytes:        %lu\n", st.serialBytes);
+  printf("isr calls:           %lu\n", st.isrCalls);
+  printf("watchdog trips:      %lu\n", st.watchdogTrips);
+  if(const watchdog::Crash* crash = watchdog::lastCrash())
+    printf("last watchdog trip:  stage 0x%02x entered at %lu ms\n", crash->last.stage, (unsigned long)crash->last.stageMs);
+  printf("eeprom byte writes:  %lu\n", st.eepromWrites);
+  if(season_days) sim::seasonReport();
+  printf("stage latency (last telemetry window, virtual time):\n");
+  for(int i = 0; i < PROFILER_STAGES; ++i)
+  {
+    const profiler::Stage& stage = profiler::stage(i);
+    if(!stage.count) continue;
+    printf("  %s %d: %u runs, min %.1f us, mean %.1f us, max %.1f us\n", i == PROFILER_TICK_STAGE ? "tick " : "task ", i,
+           stage.count, stage.min / 2.0, stage.sum / 2.0 / stage.count, stage.max / 2.0);
+  }
+  if(capture) fclose(capture);
+  if(eeprom_path && (eeprom = fopen(eeprom_path, "wb")))
+  {
+    sim::saveEeprom(eeprom);
+    fclose(eeprom);
+  }
+  return 0;
+}
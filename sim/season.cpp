@@ -0,0 +1,292 @@
+//growing season model, see season.h
+//
+//soil: a bucket of plant available water per zone (FIELD_CAPACITY_MM when full). the pump adds
+//its flow once the pipe is filled and rain adds directly, both to a surface pond that soaks in at
+//INFILTRATION_MM_PER_H (a clay bed) - what the pond cannot hold above SURFACE_STORAGE_MM runs off
+//and is lost. whatever is above field capacity drains.
+//evapotranspiration takes the reference ET0 of the hour, reduced linearly below STRESS_FRACTION
+//of field capacity where the plants start to suffer - the time spent there is reported as dry hours.
+//each zone has two probes at different depths, a probe reads dry below its PROBE_DRY_FRACTION
+//
+//weather CSV, one row per hour (# starts a comment, a header line is skipped):
+//  hour,temp_c,humidity_pct,rain_mm,et0_mm
+//hour counts from the start of the run, a row holds until the next one and the file is replayed
+//from the beginning when the season is longer. temperature and humidity go to the simulated DHT11
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "Arduino.h"
+#include "sim.h"
+#include "season.h"
+#include "config.h"
+#include "pumps.h"
+#include "et.h"
+#include "history.h"
+
+namespace
+{
+  const uint64_t STEP_US = 60000000ULL;         //model step, one virtual minute
+  const double ZONE_AREA_M2 = 1.0;              //watered area, 1 l of water is 1 mm over 1 m2
+  const double FIELD_CAPACITY_MM = 40;          //plant available water of the root zone
+  const double STRESS_FRACTION = 0.5;
+  const double PROBE_DRY_FRACTION[2] = {0.55, 0.5};
+  const double INFILTRATION_MM_PER_H = 4;
+  const double SURFACE_STORAGE_MM = 0.5;
+  const uint64_t PIPE_FILL_US = _DELAY_CONSTANT_SEC * 1000000ULL;
+  const double FLOW_L_PER_US = (double)_WATER_L_PER_SEC.raw() / Q16_16::ONE / 1e6;
+  const int SYNTHETIC_DAYS = 366;
+
+  struct Weather
+  {
+    double hour;
+    double temperature;
+    double humidity;
+    double rainMm;
+    double et0Mm;
+  };
+
+  struct ZoneModel
+  {
+    double storageMm;
+    double minStorageMm;
+    double pendingL;        //delivered since the last model step
+    double litres;
+    double pondMm;
+    double pondPumpedMm;    //share of the pond that came from the pump
+    double runoffMm;        //of the pumped water
+    double rainRunoffMm;
+    double drainedMm;
+    double dryMinutes;
+    unsigned long starts;
+    uint64_t runUs;
+    uint64_t runStartUs;
+    bool relayOn;
+    bool probeDry[2];
+  };
+
+  std::vector<Weather> weather_;
+  size_t weatherRow_;
+  double weatherPeriodH_;
+  ZoneModel zones_[ZONE_COUNT];
+  uint64_t startUs_;
+  uint64_t lastUs_;
+  uint64_t nextStepUs_;
+  long lastHour_ = -1;
+  double rainMm_;
+  double et0Mm_;
+  double estimatedEt0Mm_;   //the firmware's estimate, held an hour at a time
+
+  double clamp(const double v, const double lo, const double hi)
+  {
+    return v < lo ? lo : v > hi ? hi : v;
+  }
+
+  bool loadWeather(const char* path)
+  {
+    FILE* f = fopen(path, "r");
+    if(!f) return false;
+
+    char line[160];
+    while(fgets(line, sizeof(line), f))
+    {
+      Weather w;
+      if(line[0] == '#') continue;
+      if(sscanf(line, "%lf,%lf,%lf,%lf,%lf", &w.hour, &w.temperature, &w.humidity, &w.rainMm, &w.et0Mm) != 5) continue;
+      if(!weather_.empty() && w.hour <= weather_.back().hour) continue;
+      weather_.push_back(w);
+    }
+    fclose(f);
+    return !weather_.empty();
+  }
+
+  //a summer from spring to autumn: daily mean 14..22 degC, +-6 degC over the day,
+  //rain on about every fourth day, ET0 of 2..5 mm a day spread over the daylight hours
+  void syntheticWeather()
+  {
+    uint32_t rng = 12345;
+    const double PI = 3.14159265358979;
+
+    for(int day = 0; day < SYNTHETIC_DAYS; ++day)
+    {
+      rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+      bool rain_day = rng % 4 == 0;
+      int rain_hour = 8 + rng / 4 % 12;
+      double rain_mm = 3 + rng / 64 % 18;
+      double mean = 14 + 8 * sin(PI * (day % 183) / 183);
+      double et0_day = (0.15 * mean + 1) * (rain_day ? 0.3 : 1);
+
+      for(int hour = 0; hour < 24; ++hour)
+      {
+        bool raining = rain_day && hour >= rain_hour && hour < rain_hour + 3;
+        double temperature = mean + 6 * sin(2 * PI * (hour - 9) / 24);
+        Weather w;
+        w.hour = day * 24 + hour;
+        w.temperature = temperature;
+        w.humidity = raining ? 90 : clamp(70 - 2.5 * (temperature - mean), 20, 90);
+        w.rainMm = raining ? rain_mm / 3 : 0;
+        w.et0Mm = hour > 6 && hour < 18 ? et0_day * sin(PI * (hour - 6) / 12) * PI / 24 : 0;
+        weather_.push_back(w);
+      }
+    }
+  }
+
+  const Weather& weatherAt(const double hour)
+  {
+    double h = fmod(hour, weatherPeriodH_);
+    if(h < weather_[weatherRow_].hour) weatherRow_ = 0;
+    while(weatherRow_ + 1 < weather_.size() && weather_[weatherRow_ + 1].hour <= h) ++weatherRow_;
+    return weather_[weatherRow_];
+  }
+
+  //the relay of the zone was on from from_us to to_us, water flows once the pipe is filled
+  void pump(ZoneModel& z, const uint64_t from_us, const uint64_t to_us)
+  {
+    uint64_t wet_from = z.runStartUs + PIPE_FILL_US > from_us ? z.runStartUs + PIPE_FILL_US : from_us;
+    if(to_us > wet_from)
+    {
+      z.pendingL += (to_us - wet_from) * FLOW_L_PER_US;
+      z.litres += (to_us - wet_from) * FLOW_L_PER_US;
+    }
+    z.runUs += to_us - from_us;
+  }
+
+  void step(const uint64_t at_us)
+  {
+    double hour = (at_us - startUs_) / 3600e6;
+    const Weather& w = weatherAt(hour);
+    if((long)hour != lastHour_)
+    {
+      lastHour_ = hour;
+      estimatedEt0Mm_ += et::dailyMm().raw() / 256.0 / 24;
+      sim::setDht11(lround(clamp(w.humidity, 20, 90)), lround(clamp(w.temperature, 0, 50)));
+    }
+
+    double rain = w.rainMm / 60;
+    double et0 = w.et0Mm / 60;
+    rainMm_ += rain;
+    et0Mm_ += et0;
+
+    for(int i = 0; i < ZONE_COUNT; ++i)
+    {
+      ZoneModel& z = zones_[i];
+      double pumped = z.pendingL / ZONE_AREA_M2;
+      z.pendingL = 0;
+      z.pondMm += pumped + rain;
+      z.pondPumpedMm += pumped;
+
+      //the pond soaks in and overflows in proportion to where its water came from
+      double share = z.pondMm > 0 ? z.pondPumpedMm / z.pondMm : 0;
+      double soaked = z.pondMm < INFILTRATION_MM_PER_H / 60 ? z.pondMm : INFILTRATION_MM_PER_H / 60;
+      double runoff = z.pondMm - soaked > SURFACE_STORAGE_MM ? z.pondMm - soaked - SURFACE_STORAGE_MM : 0;
+      z.pondMm -= soaked + runoff;
+      z.pondPumpedMm -= (soaked + runoff) * share;
+      z.runoffMm += runoff * share;
+      z.rainRunoffMm += runoff * (1 - share);
+      z.storageMm += soaked;
+
+      z.storageMm -= et0 * clamp(z.storageMm / (STRESS_FRACTION * FIELD_CAPACITY_MM), 0, 1);
+      if(z.storageMm > FIELD_CAPACITY_MM)
+      {
+        z.drainedMm += z.storageMm - FIELD_CAPACITY_MM;
+        z.storageMm = FIELD_CAPACITY_MM;
+      }
+      if(z.storageMm < 0) z.storageMm = 0;
+      if(z.storageMm < z.minStorageMm) z.minStorageMm = z.storageMm;
+      if(z.storageMm < STRESS_FRACTION * FIELD_CAPACITY_MM) ++z.dryMinutes;
+
+      const int probe_pin[2] = {ZONE_PINS[i].soil1, ZONE_PINS[i].soil2};
+      for(int p = 0; p < 2; ++p)
+      {
+        bool dry = z.storageMm < PROBE_DRY_FRACTION[p] * FIELD_CAPACITY_MM;
+        if(dry == z.probeDry[p]) continue;
+        z.probeDry[p] = dry;
+        sim::setPin(probe_pin[p], dry ? HIGH : LOW);
+      }
+    }
+  }
+}
+
+namespace sim
+{
+  bool seasonStart(const char* weather_path)
+  {
+    if(weather_path && !loadWeather(weather_path))
+    {
+      fprintf(stderr, "sim: cannot read weather from %s\n", weather_path);
+      return false;
+    }
+    if(!weather_path) syntheticWeather();
+    weatherPeriodH_ = weather_.back().hour + 1;
+
+    startUs_ = lastUs_ = sim::nowUs();
+    nextStepUs_ = startUs_;
+    for(int i = 0; i < ZONE_COUNT; ++i)
+    {
+      zones_[i] = {};
+      zones_[i].storageMm = zones_[i].minStorageMm = FIELD_CAPACITY_MM;
+      sim::setPin(ZONE_PINS[i].soil1, LOW);
+      sim::setPin(ZONE_PINS[i].soil2, LOW);
+    }
+    step(startUs_);
+    nextStepUs_ += STEP_US;
+    return true;
+  }
+
+  void seasonUpdate()
+  {
+    uint64_t now = sim::nowUs();
+
+    //the relay state of the previous update held until it changed - the loop pass that switched it
+    //may have slept for a long fast forward afterwards, so the time of the change is taken from the pin
+    for(int i = 0; i < ZONE_COUNT; ++i)
+    {
+      ZoneModel& z = zones_[i];
+      bool on = sim::readPin(ZONE_PINS[i].relayOut) == LOW;
+      uint64_t edge_us = on != z.relayOn ? sim::outputChangeUs(ZONE_PINS[i].relayOut) : now;
+
+      if(z.relayOn) pump(z, lastUs_, edge_us);
+      if(on && !z.relayOn)
+      {
+        z.runStartUs = edge_us;
+        ++z.starts;
+        pump(z, edge_us, now);
+      }
+      z.relayOn = on;
+    }
+    lastUs_ = now;
+
+    while(now >= nextStepUs_)
+    {
+      step(nextStepUs_);
+      nextStepUs_ += STEP_US;
+    }
+  }
+
+  uint64_t seasonNextStepUs()
+  {
+    return nextStepUs_;
+  }
+
+  void seasonReport()
+  {
+    double days = (lastUs_ - startUs_) / 86400e6;
+    double litres = 0, runoff_l = 0;
+    printf("season:              %.1f days, rain %.0f mm, ET0 %.0f mm\n", days, rainMm_, et0Mm_);
+    for(int i = 0; i < ZONE_COUNT; ++i)
+    {
+      const ZoneModel& z = zones_[i];
+      printf("  zone %d: %.1f l delivered, %lu pump starts, %.1f h pumping, %.1f dry hours, lowest soil water %.0f %%, drained %.0f mm\n",
+             i + 1, z.litres, z.starts, z.runUs / 3600e6, z.dryMinutes / 60, 100 * z.minStorageMm / FIELD_CAPACITY_MM, z.drainedMm);
+      printf("          %.1f l ran off (%.0f %% absorbed), rain ran off %.0f mm\n", z.runoffMm * ZONE_AREA_M2,
+             z.litres > 0 ? 100 * (1 - z.runoffMm * ZONE_AREA_M2 / z.litres) : 100, z.rainRunoffMm);
+      litres += z.litres;
+      runoff_l += z.runoffMm * ZONE_AREA_M2;
+    }
+    printf("watering efficiency: %.0f %% of %.1f l absorbed\n", litres > 0 ? 100 * (1 - runoff_l / litres) : 100, litres);
+    printf("sensor history:      %u samples (%.1f days) in %u of %d bytes\n", history::samples(),
+           history::samples() * HISTORY_SAMPLE_SEC / 86400.0, history::bytes(), HISTORY_BYTES);
+    printf("ET0 estimate:        %.0f mm from the air sensor (%.0f %% of the model)\n", estimatedEt0Mm_,
+           et0Mm_ > 0 ? 100 * estimatedEt0Mm_ / et0Mm_ : 100);
+  }
+}
@@ -0,0 +1,20 @@
+#ifndef SIM_SEASON_H
+#define SIM_SEASON_H
+
+#include <stdint.h>
+
+//growing season model for long runs (sim/gws_sim --season days)
+//a soil water bucket per zone filled by its pump and the rain and emptied by evapotranspiration,
+//drives the soil sensor pins; hourly weather (replayed from a CSV or synthetic) feeds the DHT11
+namespace sim
+{
+  //weather_path null - synthetic summer weather
+  bool seasonStart(const char* weather_path);
+  //after every loop pass: books the pump run time, steps the model once a virtual minute
+  void seasonUpdate();
+  //the next model step, the loop may sleep through everything before it
+  uint64_t seasonNextStepUs();
+  void seasonReport();
+}
+
+#endif
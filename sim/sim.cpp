@@ -0,0 +1,783 @@
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include "avr/wdt.h"
+#include "sim.h"
+#include "hwtimer.h"
+#include "fastio.h"
+#include "adc.h"
+#include "profiler.h"
+#include "persist.h"
+#include "watchdog.h"
+#include "power.h"
+#include "debounce.h"
+#include "custom_interface.h"
+
+namespace
+{
+#if defined(FASTIO_MEGA)
+  const int PIN_COUNT = 70;
+  const int INT_COUNT = 6;
+#else
+  const int PIN_COUNT = 32;
+  const int INT_COUNT = 5;
+#endif
+  const int EVENT_CAPACITY = 128;
+  const uint64_t ADC_CONVERSION_US = 104;   //13 ADC clocks at 125 kHz
+  const uint64_t ANALOG_READ_US = 112;      //conversion plus call overhead
+  const uint64_t YIELD_US = 1;                    //cost of one iteration of a busy-wait loop
+  const int SERIAL_BUFFER_SIZE = 64;
+  const int SERIAL_RX_SIZE = 64;
+  const uint64_t EEPROM_WRITE_US = 3400;          //erase and write of one byte
+  const uint64_t TIMER0_OVERFLOW_US = 1024;       //millis() tick, wakes the idle sleep
+  const uint64_t INPUT_SETTLE_US = 500000;        //longer than the switch debouncing (4 samples ~50 ms) and an ADC round
+
+#if defined(FASTIO_MEGA)
+  //Arduino Mega external interrupts
+  const int INT_PIN[INT_COUNT] = {2, 3, 21, 20, 19, 18};
+#else
+  //Arduino Leonardo external interrupts
+  const int INT_PIN[INT_COUNT] = {3, 2, 0, 1, 7};
+#endif
+
+  struct Pin
+  {
+    uint8_t mode;
+    uint8_t out;
+    uint64_t outChangeUs;
+    bool driven;
+    uint8_t ext;
+    int adc;
+  };
+
+  struct Event
+  {
+    uint64_t t;
+    uint8_t pin;
+    int8_t level;  //-1 releases the pin
+  };
+
+  struct Interrupt
+  {
+    void (*isr)();
+    int mode;
+  };
+
+  uint64_t g_us;
+  Pin g_pin[PIN_COUNT];
+  Interrupt g_int[INT_COUNT];
+  Event g_event[EVENT_CAPACITY];
+  int g_eventCount;
+  sim::Stats g_stats;
+  bool g_serialEcho;
+  uint8_t g_serialRx[SERIAL_RX_SIZE];
+  int g_serialRxHead;
+  int g_serialRxCount;
+  FILE* g_serialCapture;
+  uint8_t g_eeprom[PERSIST_EEPROM_SIZE];
+  uint64_t g_eepromReadyUs;
+  uint64_t g_inputChangeUs;
+  uint64_t g_fastForwardUs;
+
+  //on-chip peripherals that complete after a delay: Timer3 one-shot, the ADC and Timer0 compare B
+  struct Pending
+  {
+    void (*callback)();
+    uint64_t dueUs;
+  };
+  Pending g_timer;
+  Pending g_adc;
+  Pending g_tick;
+  Pending g_flowTick;
+  Pending* const PENDING[] = {&g_timer, &g_adc, &g_tick, &g_flowTick};
+
+  //hall effect flow meter that pulses while its pump relay (active low) is on
+  const int FLOW_METER_CAPACITY = 4;
+  struct FlowModel
+  {
+    uint8_t relayPin;
+    uint8_t flowPin;
+    unsigned long hz;
+    uint64_t nextUs;
+  };
+  FlowModel g_flow[FLOW_METER_CAPACITY];
+  int g_flowCount;
+  uint8_t g_adcPin;
+
+  bool g_wdtEnabled;
+  uint64_t g_wdtTimeoutUs;
+  uint64_t g_wdtLastKickUs;
+
+  int g_dhtPin = -1;
+  int g_dhtHumidity = 55;
+  int g_dhtTemperature = 21;
+  bool g_dhtBadChecksum;
+  uint64_t g_dhtLowStartUs;
+  uint64_t g_dhtLowLenUs;
+
+  int level(const Pin& p)
+  {
+    if(p.mode == OUTPUT) return p.out;
+    if(p.driven) return p.ext;
+    return p.mode == INPUT_PULLUP ? HIGH : LOW;
+  }
+
+  void fireIsr(int n)
+  {
+    ++g_stats.isrCalls;
+    g_int[n].isr();
+  }
+
+  //false when the level stays
+  bool applyLevel(uint8_t pin, int8_t lvl)
+  {
+    Pin& p = g_pin[pin];
+    int before = level(p);
+
+    if(lvl < 0) p.driven = false;
+    else
+    {
+      p.driven = true;
+      p.ext = lvl;
+    }
+
+    int after = level(p);
+    if(before == after) return false;
+
+    for(int n = 0; n < INT_COUNT; ++n)
+    {
+      if(INT_PIN[n] != pin || !g_int[n].isr) continue;
+      if( g_int[n].mode == CHANGE ||
+         (g_int[n].mode == FALLING && after == LOW) ||
+         (g_int[n].mode == RISING && after == HIGH) )
+        fireIsr(n);
+    }
+    return true;
+  }
+
+  void schedule(uint64_t t, uint8_t pin, int8_t lvl)
+  {
+    if(g_eventCount == EVENT_CAPACITY) return;
+
+    int i = g_eventCount++;
+    while(i > 0 && g_event[i-1].t > t)
+    {
+      g_event[i] = g_event[i-1];
+      --i;
+    }
+    g_event[i].t = t;
+    g_event[i].pin = pin;
+    g_event[i].level = lvl;
+  }
+
+  //DHT11 answer to the start signal: 80 us low, 80 us high, then 40 bits of
+  //50 us low + 26 us (zero) or 70 us (one) high, then 50 us low before release
+  void scheduleDhtFrame()
+  {
+    byte bits[5] = {(byte)g_dhtHumidity, 0, (byte)g_dhtTemperature, 0, 0};
+    bits[4] = bits[0] + bits[2];
+    if(g_dhtBadChecksum) ++bits[4];
+
+    uint64_t t = g_us + 20;
+    schedule(t, g_dhtPin, LOW);
+    t += 80;
+    schedule(t, g_dhtPin, HIGH);
+    t += 80;
+    for(int i = 0; i < 40; ++i)
+    {
+      schedule(t, g_dhtPin, LOW);
+      t += 50;
+      schedule(t, g_dhtPin, HIGH);
+      t += (bits[i/8] & (0x80 >> (i%8))) ? 70 : 26;
+    }
+    schedule(t, g_dhtPin, LOW);
+    t += 50;
+    schedule(t, g_dhtPin, -1);
+  }
+
+  bool flowing(const FlowModel& f)
+  {
+    return f.hz && g_pin[f.relayPin].mode == OUTPUT && g_pin[f.relayPin].out == LOW;
+  }
+
+  void flowPulse();
+
+  void armFlow()
+  {
+    g_flowTick.callback = nullptr;
+    for(int i = 0; i < g_flowCount; ++i)
+    {
+      if(!flowing(g_flow[i])) continue;
+      if(!g_flowTick.callback || g_flow[i].nextUs < g_flowTick.dueUs) g_flowTick.dueUs = g_flow[i].nextUs;
+      g_flowTick.callback = flowPulse;
+    }
+  }
+
+  void flowPulse()
+  {
+    for(int i = 0; i < g_flowCount; ++i)
+    {
+      FlowModel& f = g_flow[i];
+      if(!flowing(f) || f.nextUs > g_us) continue;
+      applyLevel(f.flowPin, LOW);
+      applyLevel(f.flowPin, HIGH);
+      f.nextUs += 1000000 / f.hz;
+    }
+    armFlow();
+  }
+
+  void writePin(uint8_t pin, uint8_t val)
+  {
+    if(pin >= PIN_COUNT) return;
+    if(g_pin[pin].out != (val ? HIGH : LOW)) g_pin[pin].outChangeUs = g_us;
+
+    for(int i = 0; i < g_flowCount; ++i)
+    {
+      FlowModel& f = g_flow[i];
+      if(f.relayPin != pin || g_pin[pin].out == (val ? HIGH : LOW)) continue;
+      g_pin[pin].out = val ? HIGH : LOW;
+      if(f.hz) f.nextUs = g_us + 1000000 / f.hz;
+      armFlow();
+    }
+
+    if(pin == g_dhtPin && g_pin[pin].mode == OUTPUT)
+    {
+      if(!val && g_pin[pin].out) g_dhtLowStartUs = g_us;
+      else if(val && !g_pin[pin].out) g_dhtLowLenUs = g_us - g_dhtLowStartUs;
+    }
+    g_pin[pin].out = val ? HIGH : LOW;
+  }
+
+  void checkWatchdog()
+  {
+    if(g_wdtEnabled && g_us - g_wdtLastKickUs > g_wdtTimeoutUs)
+    {
+      ++g_stats.watchdogTrips;
+      watchdog::expired(0);
+    }
+    g_wdtLastKickUs = g_us;
+  }
+}
+
+namespace sim
+{
+  uint64_t nowUs()
+  {
+    return g_us;
+  }
+
+  void advanceUs(uint64_t us)
+  {
+    uint64_t target = g_us + us;
+
+    for(;;)
+    {
+      bool pin_due = g_eventCount && g_event[0].t <= target;
+      Pending* next = nullptr;
+
+      for(Pending* p : PENDING)
+        if(p->callback && p->dueUs <= target && (!next || p->dueUs < next->dueUs)) next = p;
+
+      if(next && (!pin_due || next->dueUs <= g_event[0].t))
+      {
+        void (*callback)() = next->callback;
+        next->callback = nullptr;
+        if(next->dueUs > g_us) g_us = next->dueUs;
+        ++g_stats.isrCalls;
+        callback();
+        continue;
+      }
+      if(!pin_due) break;
+
+      Event e = g_event[0];
+      --g_eventCount;
+      memmove(g_event, g_event + 1, g_eventCount * sizeof(Event));
+      if(e.t > g_us) g_us = e.t;
+      applyLevel(e.pin, e.level);
+    }
+    //an interrupt handler may have advanced the clock further (nested delay)
+    if(target > g_us) g_us = target;
+  }
+
+  void setPin(uint8_t pin, int level)
+  {
+    if(pin < PIN_COUNT && applyLevel(pin, level ? HIGH : LOW)) g_inputChangeUs = g_us;
+  }
+
+  int readPin(uint8_t pin)
+  {
+    return pin < PIN_COUNT ? level(g_pin[pin]) : LOW;
+  }
+
+  uint64_t outputChangeUs(uint8_t pin)
+  {
+    return pin < PIN_COUNT ? g_pin[pin].outChangeUs : 0;
+  }
+
+  void attachFlowMeter(uint8_t relay_pin, uint8_t flow_pin, unsigned long hz)
+  {
+    if(g_flowCount == FLOW_METER_CAPACITY || relay_pin >= PIN_COUNT || flow_pin >= PIN_COUNT) return;
+    g_flow[g_flowCount++] = {relay_pin, flow_pin, hz, 0};
+    applyLevel(flow_pin, HIGH);
+  }
+
+  void setFlowRate(uint8_t flow_pin, unsigned long hz)
+  {
+    for(int i = 0; i < g_flowCount; ++i)
+    {
+      if(g_flow[i].flowPin != flow_pin) continue;
+      g_flow[i].hz = hz;
+      if(hz) g_flow[i].nextUs = g_us + 1000000 / hz;
+    }
+    armFlow();
+  }
+
+  void setAnalog(uint8_t pin, int value)
+  {
+    if(pin < A0) pin += A0;
+    if(pin >= PIN_COUNT || g_pin[pin].adc == value) return;
+    g_pin[pin].adc = value;
+    g_inputChangeUs = g_us;
+  }
+
+  void attachDht11(uint8_t pin)
+  {
+    g_dhtPin = pin;
+  }
+
+  void setDht11(int humidity, int temperature)
+  {
+    g_dhtHumidity = humidity;
+    g_dhtTemperature = temperature;
+  }
+
+  void setDht11BadChecksum(bool bad)
+  {
+    g_dhtBadChecksum = bad;
+  }
+
+  void setSerialEcho(bool echo)
+  {
+    g_serialEcho = echo;
+  }
+
+  void setSerialCapture(FILE* file)
+  {
+    g_serialCapture = file;
+  }
+
+  void serialReceive(uint8_t c)
+  {
+    if(g_serialRxCount == SERIAL_RX_SIZE) return;
+    g_serialRx[(g_serialRxHead + g_serialRxCount++) % SERIAL_RX_SIZE] = c;
+  }
+
+  void loadEeprom(FILE* file)
+  {
+    memset(g_eeprom, 0xFF, sizeof(g_eeprom));
+    if(file && fread(g_eeprom, 1, sizeof(g_eeprom), file) != sizeof(g_eeprom)) memset(g_eeprom, 0xFF, sizeof(g_eeprom));
+  }
+
+  void saveEeprom(FILE* file)
+  {
+    fwrite(g_eeprom, 1, sizeof(g_eeprom), file);
+  }
+
+  void setFastForward(uint64_t limit_us)
+  {
+    g_fastForwardUs = limit_us;
+  }
+
+  const Stats& stats()
+  {
+    return g_stats;
+  }
+
+  uint64_t coreCycles()
+  {
+    return g_stats.digitalReads * DIGITAL_READ_CYCLES + g_stats.digitalWrites * DIGITAL_WRITE_CYCLES +
+           g_stats.portReads * PORT_READ_CYCLES + g_stats.portWrites * PORT_WRITE_CYCLES +
+           g_stats.clockReads * CLOCK_READ_CYCLES + g_stats.serialBytes * SERIAL_WRITE_CYCLES;
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin >= PIN_COUNT) return;
+
+  //DHT11 start signal: host released the line after holding it low for at least 18 ms
+  if(pin == g_dhtPin && g_pin[pin].mode == OUTPUT && mode != OUTPUT && g_dhtLowLenUs >= 18000)
+  {
+    g_dhtLowLenUs = 0;
+    scheduleDhtFrame();
+  }
+  g_pin[pin].mode = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  ++g_stats.digitalWrites;
+  writePin(pin, val);
+}
+
+int digitalRead(uint8_t pin)
+{
+  ++g_stats.digitalReads;
+  if(pin >= PIN_COUNT) return LOW;
+  return level(g_pin[pin]);
+}
+
+int analogRead(uint8_t pin)
+{
+  ++g_stats.analogReads;
+  sim::advanceUs(ANALOG_READ_US);
+  if(pin < A0) pin += A0;
+  if(pin >= PIN_COUNT) return 0;
+  return g_pin[pin].adc;
+}
+
+unsigned long millis()
+{
+  ++g_stats.clockReads;
+  return (uint32_t)(g_us / 1000);
+}
+
+unsigned long micros()
+{
+  ++g_stats.clockReads;
+  return (uint32_t)g_us;
+}
+
+void delay(unsigned long ms)
+{
+  sim::advanceUs((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sim::advanceUs(us);
+}
+
+void yield()
+{
+  sim::advanceUs(YIELD_US);
+
+  //a busy wait that outlives the watchdog would reset the board - there is nothing left to simulate
+  if(g_wdtEnabled && g_us - g_wdtLastKickUs > g_wdtTimeoutUs)
+  {
+    watchdog::expired(0);
+    fprintf(stderr, "sim: watchdog reset at %.3f s (firmware stuck in a busy wait in stage 0x%02x entered at %lu ms)\n",
+            g_us / 1e6, watchdog::lastCrash()->last.stage, (unsigned long)watchdog::lastCrash()->last.stageMs);
+    exit(2);
+  }
+}
+
+int digitalPinToInterrupt(uint8_t pin)
+{
+  for(int n = 0; n < INT_COUNT; ++n)
+    if(INT_PIN[n] == pin) return n;
+  return NOT_AN_INTERRUPT;
+}
+
+void attachInterrupt(uint8_t interrupt_num, void (*user_func)(), int mode)
+{
+  if(interrupt_num >= INT_COUNT) return;
+  g_int[interrupt_num].isr = user_func;
+  g_int[interrupt_num].mode = mode;
+}
+
+void detachInterrupt(uint8_t interrupt_num)
+{
+  if(interrupt_num >= INT_COUNT) return;
+  g_int[interrupt_num].isr = nullptr;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+void noInterrupts()
+{
+}
+
+void interrupts()
+{
+}
+
+namespace fastio
+{
+  uint8_t readPort(const uint8_t port)
+  {
+    //pins of every port, looked up once - long runs snapshot the ports on every scheduler tick
+    static uint8_t port_pins[PORT_COUNT][sizeof(PIN_PORT)];
+    static uint8_t port_pin_count[PORT_COUNT];
+    static bool mapped = false;
+    if(!mapped)
+    {
+      for(int pin = 0; pin < (int)sizeof(PIN_PORT); ++pin)
+        port_pins[PIN_PORT[pin]][port_pin_count[PIN_PORT[pin]]++] = pin;
+      mapped = true;
+    }
+
+    uint8_t value = 0;
+
+    ++g_stats.portReads;
+    for(int i = 0; i < port_pin_count[port]; ++i)
+    {
+      uint8_t pin = port_pins[port][i];
+      if(level(g_pin[pin])) value |= 1 << PIN_BIT[pin];
+    }
+    return value;
+  }
+
+  void writePort(const uint8_t port, const uint8_t mask, const bool level)
+  {
+    ++g_stats.portWrites;
+    for(int pin = 0; pin < (int)sizeof(PIN_PORT); ++pin)
+      if(PIN_PORT[pin] == port && (mask & (1 << PIN_BIT[pin]))) writePin(pin, level);
+  }
+}
+
+namespace
+{
+  void adcConversionComplete()
+  {
+    adc::conversionDone(g_pin[g_adcPin].adc);
+  }
+}
+
+namespace adc
+{
+  void startConversion(const uint8_t pin)
+  {
+    ++g_stats.adcConversions;
+    g_adcPin = pin < A0 ? pin + A0 : pin;
+    g_adc.callback = adcConversionComplete;
+    g_adc.dueUs = g_us + ADC_CONVERSION_US;
+  }
+}
+
+namespace
+{
+  void timer0CompareB()
+  {
+    g_tick.callback = timer0CompareB;
+    g_tick.dueUs += TIMER0_OVERFLOW_US;
+    debounce::timerTick();
+  }
+}
+
+namespace debounce
+{
+  void startTimer()
+  {
+    g_tick.callback = timer0CompareB;
+    g_tick.dueUs = (g_us / TIMER0_OVERFLOW_US + 1) * TIMER0_OVERFLOW_US;
+  }
+}
+
+namespace hwtimer
+{
+  void startOneShot(unsigned long us, void (*callback)())
+  {
+    g_timer.callback = callback;
+    g_timer.dueUs = g_us + us;
+  }
+
+  void cancel()
+  {
+    g_timer.callback = nullptr;
+  }
+}
+
+void wdt_enable(unsigned char timeout)
+{
+  if(g_wdtEnabled) checkWatchdog();
+  g_wdtEnabled = true;
+  g_wdtTimeoutUs = 15000ULL << timeout;
+  g_wdtLastKickUs = g_us;
+}
+
+void wdt_reset()
+{
+  checkWatchdog();
+}
+
+void wdt_disable()
+{
+  g_wdtEnabled = false;
+}
+
+SimSerial Serial;
+
+int SimSerial::available()
+{
+  return g_serialRxCount;
+}
+
+int SimSerial::read()
+{
+  if(!g_serialRxCount) return -1;
+  uint8_t c = g_serialRx[g_serialRxHead];
+  g_serialRxHead = (g_serialRxHead + 1) % SERIAL_RX_SIZE;
+  --g_serialRxCount;
+  return c;
+}
+
+int SimSerial::availableForWrite()
+{
+  if(!baud_ || idleAtUs_ <= g_us) return SERIAL_BUFFER_SIZE;
+
+  uint64_t byte_us = 10000000ULL / baud_;
+  uint64_t queued = (idleAtUs_ - g_us + byte_us - 1) / byte_us;
+  return queued >= SERIAL_BUFFER_SIZE ? 0 : SERIAL_BUFFER_SIZE - queued;
+}
+
+size_t SimSerial::write(uint8_t c)
+{
+  ++g_stats.serialBytes;
+  if(g_serialEcho) putchar(c);
+  if(g_serialCapture) fputc(c, g_serialCapture);
+  if(!baud_) return 1;
+
+  uint64_t byte_us = 10000000ULL / baud_;
+  while(!availableForWrite()) sim::advanceUs(idleAtUs_ - g_us - (SERIAL_BUFFER_SIZE - 1) * byte_us);
+  idleAtUs_ = (idleAtUs_ > g_us ? idleAtUs_ : g_us) + byte_us;
+  return 1;
+}
+
+void SimSerial::put(const char* s)
+{
+  for(; *s; ++s) write(*s);
+}
+
+void SimSerial::print(const char* s)
+{
+  put(s);
+}
+
+void SimSerial::print(char c)
+{
+  char s[2] = {c, 0};
+  put(s);
+}
+
+void SimSerial::print(int n)
+{
+  print((long)n);
+}
+
+void SimSerial::print(unsigned int n)
+{
+  print((unsigned long)n);
+}
+
+void SimSerial::print(long n)
+{
+  char s[24];
+  snprintf(s, sizeof(s), "%ld", n);
+  put(s);
+}
+
+void SimSerial::print(unsigned long n)
+{
+  char s[24];
+  snprintf(s, sizeof(s), "%lu", n);
+  put(s);
+}
+
+void SimSerial::print(double n, int digits)
+{
+  char s[48];
+  snprintf(s, sizeof(s), "%.*f", digits, n);
+  put(s);
+}
+
+void SimSerial::println()
+{
+  put("\r\n");
+}
+
+namespace profiler
+{
+  //Timer1 at 2 MHz (a tick is 8 CPU cycles) - blocking calls and interrupts move virtual time,
+  //the core calls a stage makes and a fixed cost per stage are charged on top of it, never host time
+  uint16_t ticks()
+  {
+    static uint64_t stages = 0;
+    return (uint16_t)(g_us * 2 + (sim::coreCycles() + ++stages * sim::STAGE_CYCLES) / 8);
+  }
+}
+
+namespace persist
+{
+  uint8_t readByte(const int address)
+  {
+    return g_eeprom[address];
+  }
+
+  bool writeReady()
+  {
+    return g_us >= g_eepromReadyUs;
+  }
+
+  void writeByte(const int address, const uint8_t value)
+  {
+    //eeprom_write_byte() waits for the previous write
+    if(!writeReady()) sim::advanceUs(g_eepromReadyUs - g_us);
+    ++g_stats.eepromWrites;
+    g_eeprom[address] = value;
+    g_eepromReadyUs = g_us + EEPROM_WRITE_US;
+  }
+}
+
+namespace
+{
+  uint64_t nextTickUs(uint64_t us)
+  {
+    return (us + TIMER0_OVERFLOW_US - 1) / TIMER0_OVERFLOW_US * TIMER0_OVERFLOW_US;
+  }
+
+  //skips the wakeups that would change nothing: no task run before interface::nextDueMs() can,
+  //a quiet task (the water poll and the ADC, the pump and EEPROM ticks while every pump is
+  //stopped) is passed over too, and the pins set from outside have been stable for INPUT_SETTLE_US.
+  //interrupt handlers in between still run (ADC, flow pulses, DHT11 edges), only the loop
+  //passes they would wake are dropped, and the Timer0 ticks are skipped altogether - the
+  //debouncing they drive has nothing to filter. the skipped passes would only have kicked the
+  //watchdog and sent telemetry. wakes at the Timer0 tick of the next change or of the fast
+  //forward limit, whichever is earlier
+  uint64_t fastForward(uint64_t wake)
+  {
+    if(g_fastForwardUs <= wake || g_us - g_inputChangeUs < INPUT_SETTLE_US) return wake;
+
+    uint32_t now_ms = (uint32_t)(g_us / 1000);
+    int32_t due_ms = (int32_t)(interface::nextDueMs() - now_ms);
+    if(due_ms <= 0) return wake;
+
+    uint64_t target = nextTickUs((g_us / 1000 + due_ms) * 1000);
+    if(target > nextTickUs(g_fastForwardUs)) target = nextTickUs(g_fastForwardUs);
+    if(target <= wake) return wake;
+
+    if(g_tick.callback) g_tick.dueUs = target;
+    g_wdtLastKickUs = target;
+    return target;
+  }
+}
+
+namespace power
+{
+  void waitForInterrupt()
+  {
+    uint64_t wake = (g_us / TIMER0_OVERFLOW_US + 1) * TIMER0_OVERFLOW_US;
+
+    for(Pending* p : PENDING)
+      if(p->callback && p->dueUs < wake) wake = p->dueUs;
+    if(g_eventCount && g_event[0].t < wake) wake = g_event[0].t;
+    if(wake <= g_us) return;
+    wake = fastForward(wake);
+
+    g_stats.sleepUs += wake - g_us;
+    sim::advanceUs(wake - g_us);
+  }
+}
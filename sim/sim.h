@@ -0,0 +1,76 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+//virtual-time HAL behind sim/Arduino.h
+//time only moves when the harness (or a blocking core call like delay()) advances it,
+//so every run is deterministic and independent of the host speed, the profiler's stage times included
+//(virtual time plus the cycle costs below, see profiler::ticks() in sim.cpp)
+namespace sim
+{
+  //rough AVR cost of one call (16 MHz, Arduino AVR core): pin table lookups and PWM check
+  //for the core functions, in/out plus the atomic read-modify-write for direct port access
+  const unsigned long DIGITAL_READ_CYCLES = 50;
+  const unsigned long DIGITAL_WRITE_CYCLES = 60;
+  const unsigned long PORT_READ_CYCLES = 3;
+  const unsigned long PORT_WRITE_CYCLES = 10;
+  const unsigned long CLOCK_READ_CYCLES = 25;     //millis()/micros() with interrupts off
+  const unsigned long SERIAL_WRITE_CYCLES = 40;   //one byte into the TX buffer
+  const unsigned long STAGE_CYCLES = 160;         //the body of a profiled stage besides the calls above, fixed
+
+  struct Stats
+  {
+    unsigned long digitalReads;
+    unsigned long digitalWrites;
+    unsigned long portReads;
+    unsigned long portWrites;
+    unsigned long analogReads;
+    unsigned long adcConversions;
+    unsigned long clockReads;
+    unsigned long serialBytes;
+    unsigned long isrCalls;
+    unsigned long watchdogTrips;
+    unsigned long eepromWrites;
+    uint64_t sleepUs;
+  };
+
+  uint64_t nowUs();
+  void advanceUs(uint64_t us);
+
+  //external drive of an input pin, fires attached interrupts on edges
+  void setPin(uint8_t pin, int level);
+  void setAnalog(uint8_t pin, int value);
+  //level of any pin as the outside world sees it, not counted as a firmware read
+  int readPin(uint8_t pin);
+  //virtual time the firmware last changed the output level of a pin
+  uint64_t outputChangeUs(uint8_t pin);
+
+  //flow meter pulsing at hz on flow_pin while the active low relay_pin is on
+  void attachFlowMeter(uint8_t relay_pin, uint8_t flow_pin, unsigned long hz);
+  void setFlowRate(uint8_t flow_pin, unsigned long hz);
+
+  //DHT11 waveform model connected to the given pin
+  void attachDht11(uint8_t pin);
+  void setDht11(int humidity, int temperature);
+  void setDht11BadChecksum(bool bad);
+
+  //lets the idle sleep skip the wakeups before the next task run that can change anything
+  //(interface::nextDueMs()), up to limit_us (0 - off). for long runs, the firmware sees the same
+  //state changes but far fewer loop passes - the quiet ones and their telemetry are left out
+  void setFastForward(uint64_t limit_us);
+
+  void setSerialEcho(bool echo);
+  void setSerialCapture(FILE* file);
+  //a byte sent to the firmware over Serial
+  void serialReceive(uint8_t c);
+  //blank (erased) EEPROM when file is null
+  void loadEeprom(FILE* file);
+  void saveEeprom(FILE* file);
+  const Stats& stats();
+  //CPU cycles of the core calls counted in stats() - the time they take does not move virtual time
+  uint64_t coreCycles();
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <arduino.h>
+#include "sysclock.h"
+
+namespace
+{
+  uint32_t nowMs_ = 0;
+  uint32_t nowSec_ = 0;
+  unsigned int msRemainder_ = 0;
+}
+
+namespace sysclock
+{
+  //seconds are accumulated from ms deltas instead of dividing millis(), this keeps
+  //them monotonic across the wrap and avoids a 32-bit division on every pass
+  void update()
+  {
+    uint32_t time_now_ms = millis();
+    uint32_t delta_ms = time_now_ms - nowMs_;
+
+    nowMs_ = time_now_ms;
+    if(delta_ms >= 1000)
+    {
+      nowSec_ += delta_ms / 1000;
+      delta_ms %= 1000;
+    }
+    msRemainder_ += delta_ms;
+    if(msRemainder_ >= 1000)
+    {
+      msRemainder_ -= 1000;
+      ++nowSec_;
+    }
+  }
+
+  uint32_t nowMs()
+  {
+    return nowMs_;
+  }
+
+  uint32_t nowSec()
+  {
+    return nowSec_;
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef SYSCLOCK_H
+#define SYSCLOCK_H
+
+#include <stdint.h>
+
+//system time sampled once per loop pass
+//all differences are unsigned, so they stay correct when millis() wraps after ~49.7 days
+namespace sysclock
+{
+  void update();
+  uint32_t nowMs();
+  uint32_t nowSec();   //monotonic, does not follow the millis() wrap back to 0
+
+  inline uint32_t elapsedMs(const uint32_t since_ms) { return nowMs() - since_ms; }
+  inline uint32_t elapsedSec(const uint32_t since_sec) { return nowSec() - since_sec; }
+}
+
+#endif
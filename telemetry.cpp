@@ -0,0 +1,112 @@
+#include <arduino.h>
+#include "telemetry.h"
+
+namespace
+{
+  uint8_t queue_[TELEMETRY_QUEUE_SIZE];
+  uint8_t head_ = 0;
+  uint8_t count_ = 0;
+  unsigned int dropped_ = 0;
+}
+
+namespace telemetry
+{
+  uint16_t crc16(const uint8_t* data, const uint8_t size)
+  {
+    uint16_t crc = 0xFFFF;
+
+    for(uint8_t i = 0; i < size; ++i)
+    {
+      crc ^= (uint16_t)data[i] << 8;
+      for(uint8_t bit = 0; bit < 8; ++bit)
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+  }
+
+  uint8_t cobsEncode(const uint8_t* in, const uint8_t size, uint8_t* out)
+  {
+    uint8_t code_at = 0;
+    uint8_t code = 1;
+    uint8_t n = 1;
+
+    for(uint8_t i = 0; i < size; ++i)
+    {
+      if(in[i])
+      {
+        out[n++] = in[i];
+        ++code;
+      }
+      if(!in[i] || code == 0xFF)
+      {
+        out[code_at] = code;
+        code_at = n++;
+        code = 1;
+      }
+    }
+    out[code_at] = code;
+    return n;
+  }
+
+  uint8_t cobsDecode(const uint8_t* in, const uint8_t size, uint8_t* out)
+  {
+    uint8_t n = 0;
+
+    for(uint8_t i = 0; i < size; )
+    {
+      uint8_t code = in[i++];
+      if(!code || i + code - 1 > size) return 0;
+      for(uint8_t k = 1; k < code; ++k) out[n++] = in[i++];
+      if(code != 0xFF && i < size) out[n++] = 0;
+    }
+    return n;
+  }
+
+  bool send(const Record& record)
+  {
+    uint8_t frame[TELEMETRY_MAX_RECORD + 2];
+    uint8_t encoded[TELEMETRY_MAX_RECORD + 4];
+    uint8_t size = record.size();
+    uint16_t crc = crc16(record.data(), size);
+
+    memcpy(frame, record.data(), size);
+    frame[size++] = crc;
+    frame[size++] = crc >> 8;
+    size = cobsEncode(frame, size, encoded);
+    encoded[size++] = 0;
+
+    if(size > TELEMETRY_QUEUE_SIZE - count_)
+    {
+      ++dropped_;
+      return false;
+    }
+    for(uint8_t i = 0; i < size; ++i)
+      queue_[(head_ + count_ + i) % TELEMETRY_QUEUE_SIZE] = encoded[i];
+    count_ += size;
+    return true;
+  }
+
+  //CRC, COBS overhead (one byte per 254) and the delimiter
+  bool room(const uint8_t size)
+  {
+    return size + 2 + (size + 2) / 254 + 2 <= TELEMETRY_QUEUE_SIZE - count_;
+  }
+
+  void service()
+  {
+    if(!count_) return;
+
+    int room = Serial.availableForWrite();
+    while(room-- > 0 && count_)
+    {
+      Serial.write(queue_[head_]);
+      head_ = (head_ + 1) % TELEMETRY_QUEUE_SIZE;
+      --count_;
+    }
+  }
+
+  unsigned int dropped()
+  {
+    return dropped_;
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+const int TELEMETRY_MAX_RECORD = 64;
+const int TELEMETRY_QUEUE_SIZE = 128;
+
+//binary telemetry: every record is protected by a CRC-16/CCITT (appended little endian),
+//COBS encoded and terminated with a 0x00 delimiter, multi-byte fields are little endian
+//
+//RECORD_STATUS layout:
+//  u8  type
+//  u32 timestamp [s]
+//  u16 frames dropped for a full TX queue since boot
+//  i16 air temperature, i16 air humidity, i16 dew point [Q8.8]
+//  u8  air flags: bit0 watering allowed, bit1 sensor error
+//  u16 evapotranspiration estimate [Q8.8 mm/day], u8 hours it is based on
+//  u8  water in tank
+//  u8  first zone, u8 zone count, then for every zone of the chunk:
+//    u8  flags: bit0 manual switch on, bit1 waiting for the start arbiter
+//    u8  soil flags: bit7 sensor present, bit0 wants water, bit1 sensor 1 dry, bit2 sensor 2 dry
+//    u8  pump id, u8 pump state (idle, onAuto, onMan, off, soak), u16 power on cycles, u32 time between turns on [s]
+//    u8  flow faults of the last run: bit0 dry run, bit1 burst, u16 water delivered today [Q8.8 litres]
+//
+//RECORD_LATENCY layout (one profiler stage per record, see profiler.h):
+//  u8  type
+//  u8  stage
+//  u16 count, u16 min, u16 max, u16 mean [Timer1 ticks, 0.5 us]
+//  u16 histogram[PROFILER_BUCKETS]
+//
+//RECORD_RESET layout (sent once after a watchdog reset, see watchdog.h):
+//  u8  type
+//  u8  stage of the last breadcrumb, u32 its timestamp [ms since boot]
+//  u16 interrupted program counter [byte address]
+//  u8  watchdog resets in a row, cleared by any other reset
+//
+//RECORD_TRACE layout (pump state changes not sent yet, see pumps.h):
+//  u8  type
+//  u8  count, then for every transition:
+//    u32 timestamp [s], u8 pump id, u8 from state, u8 to state, u16 guards (PumpGuard bits)
+//
+//RECORD_HISTORY layout (a chunk of the sensor history dump, see history.h):
+//  u8  type
+//  u16 offset of the chunk in the dump, u16 dump size, then up to HISTORY_CHUNK bytes
+namespace telemetry
+{
+  const uint8_t RECORD_STATUS = 1;
+  const uint8_t RECORD_LATENCY = 2;
+  const uint8_t RECORD_RESET = 3;
+  const uint8_t RECORD_TRACE = 4;
+  const uint8_t RECORD_HISTORY = 5;
+
+  class Record
+  {
+    private:
+      uint8_t data_[TELEMETRY_MAX_RECORD];
+      uint8_t size_;
+    public:
+      Record(const uint8_t type) : size_(0) { put8(type); }
+      void put8(const uint8_t value) { if(size_ < TELEMETRY_MAX_RECORD) data_[size_++] = value; }
+      void put16(const uint16_t value) { put8(value); put8(value >> 8); }
+      void put32(const uint32_t value) { put16(value); put16(value >> 16); }
+      const uint8_t* data() const { return data_; }
+      uint8_t size() const { return size_; }
+  };
+
+  //frames the record into the TX queue, never blocks - a record that does not fit is dropped
+  bool send(const Record& record);
+  //a record of size bytes would be queued now
+  bool room(const uint8_t size);
+  //hands queued bytes to Serial, only as many as it accepts without blocking
+  void service();
+  unsigned int dropped();
+
+  uint16_t crc16(const uint8_t* data, const uint8_t size);
+  //returns encoded size, out needs size + size/254 + 1 bytes, no delimiter is added
+  uint8_t cobsEncode(const uint8_t* in, const uint8_t size, uint8_t* out);
+  //returns decoded size or 0 for a malformed frame
+  uint8_t cobsDecode(const uint8_t* in, const uint8_t size, uint8_t* out);
+}
+
+#endif
@@ -0,0 +1,482 @@
+#include<arduino.h>
+#include "sysclock.h"
+#include "adc.h"
+#include "et.h"
+#include "topology.h"
+
+template<PumpControl control>
+ZoneRegistry<control>::ZoneRegistry(const ZonePins* pins, const WaterSensor* pWS, const AirSensor* pAS,
+                                    const uint8_t max_running, const uint32_t stagger_ms) :
+  maxRunning_(max_running), staggerMs_(stagger_ms),
+  timePerCycle_( MAX_WATERING_TIME_SEC - _DELAY_CONSTANT_SEC > 0 ? MAX_WATERING_TIME_SEC : 2*_DELAY_CONSTANT_SEC ),
+  waterPerCycle_( (_WATER_L_PER_SEC * (timePerCycle_ - _DELAY_CONSTANT_SEC)).convert<Q24_8>() ),
+  dayStartSec_(0), potVersion_(0), etVersion_(et::version()), pWaterSensor_(pWS), pAirSensor_(pAS)
+{
+  soilDry_[0] = soilDry_[1] = 0;
+  queued_ = 0;
+  waiting_ = 0;
+  lastGrantMs_ = sysclock::nowMs() - staggerMs_;
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    relayIo_[z] = fastio::Pin(pins[z].relayOut);
+    switchIo_[z] = fastio::Pin(pins[z].switchIn);
+    state_[z] = idle;
+    flowFaults_[z] = 0;
+    cycles_[z] = 0;
+    pulsesLeft_[z] = 0;
+    lastStartSec_[z] = 0;
+    lastStopSec_[z] = 0;
+
+    pinMode(pins[z].relayOut, OUTPUT);
+    digitalWrite(pins[z].relayOut, HIGH);
+    pinMode(pins[z].switchIn, INPUT_PULLUP);
+    debounce::addPin(switchIo_[z]);
+    flowSlot_[z] = flow::attach(pins[z].flowIn, pins[z].flowPulsesPerL);
+
+    if(!SOIL) continue;
+    soilIo_[z][0] = fastio::Pin(pins[z].soil1);
+    soilIo_[z][1] = fastio::Pin(pins[z].soil2);
+    drynessCount_[z][0] = drynessCount_[z][1] = 0;
+    pinMode(pins[z].soil1, INPUT);
+    pinMode(pins[z].soil2, INPUT);
+  }
+
+  pinMode(POT_IN, INPUT);
+  adc::addChannel(POT_IN);
+  countTimeBetweenTurnsOn();
+  setCycleMode(PULSES_PER_CYCLE, SOAK_SEC);
+}
+
+//every pulse fills the pipes first and then pumps its share of the cycle
+template<PumpControl control>
+void ZoneRegistry<control>::setCycleMode(const uint8_t pulses, const unsigned long soak_sec)
+{
+  pulses_ = pulses ? pulses : 1;
+  soakSec_ = soak_sec;
+  pulseSec_ = _DELAY_CONSTANT_SEC + (timePerCycle_ - _DELAY_CONSTANT_SEC) / pulses_;
+  waterPerPulse_ = estimateWater(pulseSec_);
+}
+
+template<>
+void ZoneRegistry<SOIL_DRIVEN>::countTimeBetweenTurnsOn()
+{
+  timeBetweenTurnsOn_ = map(adc::read(POT_IN),0,1023,2*timePerCycle_,_20_MIN_SEC-timePerCycle_);
+}
+
+template<>
+void ZoneRegistry<TIMER_DRIVEN>::countTimeBetweenTurnsOn()
+{
+  //knob multiplier in Q8.8 and the day's need in proportion to the reference day
+  long multiplier = map(adc::read(POT_IN),0,1023,2*Q8_8::ONE,Q8_8::ONE/4);
+  long need = (long)WATER_PER_DAY_AT_REF_L * et::dailyMm().raw() / ET_REFERENCE_MM * multiplier >> 8;
+  if(need < waterPerCycle_.raw()) need = waterPerCycle_.raw();
+  if(need > Q24_8::fromInt(_MAX_WATER_PER_DAY_L).raw()) need = Q24_8::fromInt(_MAX_WATER_PER_DAY_L).raw();
+  waterPerDay_ = Q24_8::fromRaw(need);
+
+  //_DAY_SEC / (waterPerDay_ / waterPerCycle_) with a single integer division
+  timeBetweenTurnsOn_ = _DAY_SEC * waterPerCycle_.raw() / waterPerDay_.raw();
+}
+
+template<>
+bool ZoneRegistry<SOIL_DRIVEN>::budgetAllows(const uint8_t) const
+{
+  return true;
+}
+
+template<>
+bool ZoneRegistry<TIMER_DRIVEN>::budgetAllows(const uint8_t z) const
+{
+  return waterToday_[z] + waterPerCycle_ <= waterPerDay_;
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::readSoil()
+{
+  if(!SOIL) return;
+
+  ZoneMask dry[2] = {0, 0};
+  for(uint8_t z = 0; z < SOIL_ZONES; ++z)
+  {
+    for(int i = 0; i<2; ++i)
+    {
+      if(!fastio::readSnapshot(soilIo_[z][i])) continue;
+      dry[i] |= (ZoneMask)1 << z;
+      ++drynessCount_[z][i];
+    }
+  }
+  if(dry[0] | dry[1]) persist::touch(false);
+  soilDry_[0] = dry[0];
+  soilDry_[1] = dry[1];
+}
+
+//with a flow meter the pulse ends on delivered litres, the time limit is doubled for slow (clogged) lines
+template<PumpControl control>
+bool ZoneRegistry<control>::pulseDone(const uint8_t z, const unsigned long run_sec) const
+{
+  if(!metered(z)) return run_sec > (unsigned long)pulseSec_;
+  return flow::cycleLitres(flowSlot_[z]) >= waterPerPulse_ || run_sec > 2UL*pulseSec_;
+}
+
+template<PumpControl control>
+uint8_t ZoneRegistry<control>::checkFlow(const uint8_t z, const unsigned long run_sec) const
+{
+  if(!metered(z)) return 0;
+
+  uint8_t faults = 0;
+  if(flow::msSinceLastPulse(flowSlot_[z]) > 1000UL*_NO_FLOW_SEC) faults |= FLOW_DRY_RUN;
+  //the first seconds are too few pulses for a rate
+  if(run_sec > 2 && flow::cycleLitres(flowSlot_[z]) > (_WATER_L_PER_SEC * (long)(_BURST_FACTOR*run_sec)).template convert<Q24_8>())
+    faults |= FLOW_BURST;
+  return faults;
+}
+
+//stops the pump and books the water of the run - measured with a flow meter, estimated without
+//an automatic cycle was charged up front with the estimate of all its pulses
+template<PumpControl control>
+void ZoneRegistry<control>::finishRun(const uint8_t z, const State next, const unsigned long time_now_sec, const uint8_t faults)
+{
+  unsigned long run_sec = time_now_sec - lastStartSec_[z];
+  Q24_8 measured = flow::cycleLitres(flowSlot_[z]);
+
+  if(state_[z] == onAuto && metered(z)) waterToday_[z] = waterToday_[z] - waterPerPulse_ + measured;
+  else if(state_[z] == onMan) waterToday_[z] = waterToday_[z] + (metered(z) ? measured : estimateWater(run_sec));
+
+  flowFaults_[z] = faults;
+  lastStopSec_[z] = time_now_sec;
+  state_[z] = next;
+  persist::touch(true);
+  fastio::write(relayIo_[z], HIGH);
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::enterState(const uint8_t z, const State next, const unsigned long time_now_sec, const uint8_t faults)
+{
+  if(state_[z] == onAuto || state_[z] == onMan)
+  {
+    finishRun(z, next, time_now_sec, faults);
+    return;
+  }
+
+  const State from = (State)state_[z];
+  state_[z] = next;
+  persist::touch(true);
+  if(next == idle || next == off)
+  {
+    fastio::write(relayIo_[z], HIGH);  //just to be sure
+    return;
+  }
+
+  lastStartSec_[z] = time_now_sec;
+  if(next == onAuto && from == soak) --pulsesLeft_[z];
+  else if(next == onAuto)
+  {
+    ++cycles_[z];
+    pulsesLeft_[z] = pulses_ - 1;
+    waterToday_[z] = waterToday_[z] + waterPerPulse_ * pulses_;  //charged up front, a reset during the cycle must not hand it out again
+  }
+  flow::startCycle(flowSlot_[z]);
+  fastio::write(relayIo_[z], LOW);
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::request(const uint8_t z)
+{
+  if(waiting(z)) return;
+  queue_[queued_++] = z;
+  waiting_ |= (ZoneMask)1 << z;
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::withdraw(const uint8_t z)
+{
+  if(!waiting(z)) return;
+  uint8_t i = 0;
+  while(queue_[i] != z) ++i;
+  for(--queued_; i < queued_; ++i) queue_[i] = queue_[i + 1];
+  waiting_ &= ~((ZoneMask)1 << z);
+}
+
+template<PumpControl control>
+uint16_t ZoneRegistry<control>::sharedGuards() const
+{
+  uint16_t g = pWaterSensor_->shouldWater() ? G_TANK : G_NO_TANK;
+  if(pAirSensor_->shouldWater()) g |= G_AIR;
+  return g;
+}
+
+//the guards of a zone that do not depend on a run in progress
+template<PumpControl control>
+uint16_t ZoneRegistry<control>::zoneGuards(const uint8_t z, const unsigned long time_now_sec) const
+{
+  uint16_t g = switchOn(z) ? G_SWITCH : G_NO_SWITCH;
+  g |= soilWantsWater(z) ? G_SOIL_DRY : G_SOIL_WET;
+  if(budgetAllows(z)) g |= G_BUDGET;
+  if(state_[z] == soak && time_now_sec - lastStopSec_[z] >= soakSec_) g |= G_SOAK_OVER;
+  if(time_now_sec - lastStopSec_[z] > timeBetweenTurnsOn_) g |= G_REST_OVER;
+  return g;
+}
+
+//pump control based on internal counters. no need for greater precision
+template<PumpControl control>
+void ZoneRegistry<control>::controlPumps()
+{
+  //the knob is sampled in the background, recalculate only when it moved or the weather estimate changed
+  if(adc::version(POT_IN) != potVersion_ || et::version() != etVersion_)
+  {
+    potVersion_ = adc::version(POT_IN);
+    etVersion_ = et::version();
+    countTimeBetweenTurnsOn();
+  }
+  unsigned long time_now_sec = sysclock::nowSec();
+
+  if(time_now_sec - dayStartSec_ >= (unsigned long)_DAY_SEC)
+  {
+    dayStartSec_ = time_now_sec;
+    for(Q24_8& water : waterToday_) water = Q24_8();
+    persist::touch(false);
+  }
+
+  //inputs shared by all zones are evaluated once per tick
+  uint16_t shared = sharedGuards();
+
+  //stops first, a zone that would start only asks the arbiter
+  uint16_t guards[ZONE_COUNT];
+  ZoneMask manual = 0;
+  uint8_t running_count = 0;
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    unsigned long run_sec = time_now_sec - lastStartSec_[z];
+    uint8_t faults = 0;
+    bool running = state_[z] == onAuto || state_[z] == onMan;
+    if(running)
+    {
+      flow::read(flowSlot_[z]);
+      faults = checkFlow(z, run_sec);
+    }
+
+    uint16_t g = shared | zoneGuards(z, time_now_sec);
+    if(running && pulseDone(z, run_sec)) g |= state_[z] == onAuto && pulsesLeft_[z] ? G_PULSE_DONE : G_CYCLE_DONE;
+    if(faults) g |= G_FLOW_FAULT;
+    guards[z] = g;
+
+    State next = pumpTransition((State)state_[z], g | G_GRANT);
+    if(!running && (next == onAuto || next == onMan))
+    {
+      request(z);
+      if(next == onMan) manual |= (ZoneMask)1 << z;
+      continue;
+    }
+    withdraw(z);
+    if(next != state_[z])
+    {
+      pumptrace::record(z + 1, state_[z], next, g);
+      enterState(z, next, time_now_sec, faults);
+    }
+    if(state_[z] == onAuto || state_[z] == onMan) ++running_count;
+  }
+
+  //the arbiter: the oldest manual request first, then the oldest automatic one
+  //a switch press is not held back by the stagger, only by the supply limit
+  while(queued_ && running_count < maxRunning_ && (manual || sysclock::elapsedMs(lastGrantMs_) >= staggerMs_))
+  {
+    uint8_t i = 0;
+    if(manual) while(!(manual >> queue_[i] & 1)) ++i;
+    const uint8_t z = queue_[i];
+    withdraw(z);
+    manual &= ~((ZoneMask)1 << z);
+
+    State next = pumpTransition((State)state_[z], guards[z] | G_GRANT);
+    pumptrace::record(z + 1, state_[z], next, guards[z] | G_GRANT);
+    enterState(z, next, time_now_sec, 0);
+    ++running_count;
+    lastGrantMs_ = sysclock::nowMs();
+  }
+}
+
+//with every pump stopped only the time guards move: the end of a soak or of the rest, the day rollover
+template<PumpControl control>
+unsigned long ZoneRegistry<control>::quietMs() const
+{
+  if(queued_ || runningMask() || adc::version(POT_IN) != potVersion_ || et::version() != etVersion_) return 0;
+
+  unsigned long time_now_sec = sysclock::nowSec();
+  if(time_now_sec - dayStartSec_ >= (unsigned long)_DAY_SEC) return 0;
+
+  unsigned long quiet_sec = _DAY_SEC - (time_now_sec - dayStartSec_);
+  uint16_t shared = sharedGuards();
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    if(pumpTransition((State)state_[z], shared | zoneGuards(z, time_now_sec) | G_GRANT) != state_[z]) return 0;
+
+    unsigned long stopped_sec = time_now_sec - lastStopSec_[z];
+    if(state_[z] == soak && stopped_sec < soakSec_ && soakSec_ - stopped_sec < quiet_sec) quiet_sec = soakSec_ - stopped_sec;
+    if(stopped_sec <= timeBetweenTurnsOn_ && timeBetweenTurnsOn_ + 1 - stopped_sec < quiet_sec) quiet_sec = timeBetweenTurnsOn_ + 1 - stopped_sec;
+  }
+  return quiet_sec > 1 ? (quiet_sec - 1) * 1000 : 0;
+}
+
+template<PumpControl control>
+ZoneMask ZoneRegistry<control>::runningMask() const
+{
+  ZoneMask mask = 0;
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+    if(state_[z] == onAuto || state_[z] == onMan) mask |= (ZoneMask)1 << z;
+  return mask;
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::printInfo() const
+{
+  Serial.print(F("Minimalny czas pomiedzy uruchomieniami pomp [min]: "));
+  printFixed(Q24_8::fromRaw(timeBetweenTurnsOn_ * Q24_8::ONE / 60), 1);
+  if(!SOIL)
+  {
+    Serial.print(F(" -> "));
+    printFixed(waterPerDay_, 1);
+    Serial.print(F(" [litry na dzien], ET0 [mm/dzien]: "));
+    printFixed(et::dailyMm(), 1);
+    Serial.print(F(" z "));
+    Serial.print(et::hours());
+    Serial.print(F(" h"));
+  }
+  Serial.println();
+
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    if(SOIL)
+    {
+      Serial.print(F("Wilgotnosc gleby dla segmentu id="));
+      Serial.print(z + 1);
+      Serial.println(F(": "));
+      for(int i=0; i<2; ++i)
+      {
+        Serial.print(F("czujnik "));
+        Serial.print(i+1);
+        Serial.print(soilDry_[i] >> z & 1 ? F(": sucho") : F(": wilgotno"));
+        Serial.print(F(", wykryl suchosc gleby "));
+        Serial.print(drynessCount_[z][i]);
+        Serial.println(F(" razy"));
+      }
+    }
+    else
+    {
+      Serial.print(F("Pompa id="));
+      Serial.print(z + 1);
+      Serial.print(F(" podala dzisiaj [litry]: "));
+      printFixed(waterToday_[z], 1);
+      Serial.println();
+    }
+
+    Serial.print(F("Pompa id="));
+    Serial.print(z + 1);
+    Serial.print(F(" zostala uruchomiona "));
+    Serial.print(cycles_[z]);
+    Serial.println(F(" razy"));
+    if(waiting(z))
+    {
+      Serial.print(F("Pompa id="));
+      Serial.print(z + 1);
+      Serial.println(F(" czeka w kolejce na uruchomienie"));
+    }
+    Serial.print(F("Pompa id="));
+    Serial.print(z + 1);
+    switch(state_[z])
+    {
+      case idle:
+        Serial.println(F(" w stanie oczekiwania"));
+        break;
+      case onAuto:
+        Serial.println(F(" wlaczona automatycznie"));
+        break;
+      case onMan:
+        Serial.println(F(" wlaczona manualnie"));
+        break;
+      case off:
+        Serial.println(F(" wylaczona"));
+        break;
+      case soak:
+        Serial.println(F(" w przerwie na wsiakanie"));
+        break;
+    }
+  }
+}
+
+template<PumpControl control>
+uint8_t ZoneRegistry<control>::writeTelemetry(telemetry::Record& record, const uint8_t first) const
+{
+  const uint8_t count = ZONE_COUNT - first < ZONES_PER_STATUS ? ZONE_COUNT - first : ZONES_PER_STATUS;
+
+  record.put8(first);
+  record.put8(count);
+  for(uint8_t z = first; z < first + count; ++z)
+  {
+    record.put8(switchOn(z) | waiting(z) << 1);
+    record.put8(SOIL ? 0x80 | soilWantsWater(z) | (soilDry_[0] >> z & 1) << 1 | (soilDry_[1] >> z & 1) << 2 : 0);
+    record.put8(z + 1);
+    record.put8(state_[z]);
+    record.put16(cycles_[z]);
+    record.put32(timeBetweenTurnsOn_);
+    record.put8(flowFaults_[z]);
+    record.put16(waterToday_[z].raw() > 0xFFFF ? 0xFFFF : waterToday_[z].raw());
+  }
+  return first + count < ZONE_COUNT ? first + count : 0;
+}
+
+//u32 day age, then per zone: u8 state, u16 cycles, u32 run age while running - rest age otherwise,
+//u16 water today [Q8.8 litres] and for soil zones u16 dryness counts of both probes
+template<PumpControl control>
+void ZoneRegistry<control>::saveState(persist::Record& record) const
+{
+  unsigned long time_now_sec = sysclock::nowSec();
+
+  record.put32(time_now_sec - dayStartSec_);
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    bool running = state_[z] == onAuto || state_[z] == onMan;
+    record.put8(state_[z]);
+    record.put16(cycles_[z]);
+    record.put32(time_now_sec - (running ? lastStartSec_[z] : lastStopSec_[z]));
+    record.put16(waterToday_[z].raw() > 0xFFFF ? 0xFFFF : waterToday_[z].raw());
+    if(!SOIL) continue;
+    record.put16(drynessCount_[z][0]);
+    record.put16(drynessCount_[z][1]);
+  }
+}
+
+template<PumpControl control>
+void ZoneRegistry<control>::restoreState(persist::Record& record)
+{
+  unsigned long time_now_sec = sysclock::nowSec();
+
+  dayStartSec_ = time_now_sec - record.get32();
+  for(uint8_t z = 0; z < ZONE_COUNT; ++z)
+  {
+    uint8_t state = record.get8();
+    cycles_[z] = record.get16();
+    unsigned long age = record.get32();
+    waterToday_[z] = Q24_8::fromRaw(record.get16());
+    if(SOIL)
+    {
+      drynessCount_[z][0] = record.get16();
+      drynessCount_[z][1] = record.get16();
+    }
+
+    //the relay is released by the reset, an interrupted run continues as the rest period
+    if(state == onMan) waterToday_[z] = waterToday_[z] + estimateWater(age);
+    if(state == onAuto || state == onMan)
+    {
+      lastStartSec_[z] = time_now_sec - age;
+      lastStopSec_[z] = time_now_sec;
+      state_[z] = off;
+    }
+    else
+    {
+      //the rest of a cycle in its soak is dropped, the cycle stays charged
+      lastStopSec_[z] = time_now_sec - age;
+      state_[z] = state == off || state == soak ? off : idle;
+    }
+  }
+}
+
+template class ZoneRegistry<SOIL_DRIVEN>;
+template class ZoneRegistry<TIMER_DRIVEN>;
@@ -0,0 +1,126 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "config.h"
+#include "sensors.h"
+#include "pumps.h"
+#include "persist.h"
+#include "debounce.h"
+
+//bit per zone
+//up to 10 zones of either control type - the history flags (history.h) hold three masks in 32 bits,
+//the zone masks would allow 16, the EEPROM slot grows with the zone count (persist.h)
+typedef uint16_t ZoneMask;
+static_assert(ZONE_COUNT <= 16, "zone masks hold up to 16 zones");
+
+const int ZONES_PER_STATUS = 3;   //13 bytes each, a RECORD_STATUS carries a chunk of the zones
+
+//all watering zones: manual switch, pump, optional flow meter and - for soil controlled pumps -
+//a soil sensor segment, selected at compile time by PUMP_CONTROL
+//the state is kept in packed per-zone arrays instead of an object per zone, the water tank,
+//the weather and the knob are shared and evaluated once per control tick for all zones
+//SOIL_DRIVEN - the knob sets the shortest period between turning on (from 2*timePerCycle_ up to about 20 min)
+//TIMER_DRIVEN - the water per day per zone follows the evapotranspiration estimate (et.h), the knob is a multiplier
+//               (x2 down to x0.25), the day stays between one cycle and _MAX_WATER_PER_DAY_L
+//starts go through an arbiter: at most max_running pumps at once, automatic starts stagger_ms apart,
+//waiting zones are served in request order with manual runs ahead of automatic ones, a manual run waits only for a free pump
+//an automatic cycle runs as pulses with soak periods between them (PULSES_PER_CYCLE, SOAK_SEC),
+//a soil zone that turns wet during a soak ends the cycle early
+template<PumpControl control>
+class ZoneRegistry
+{
+  private:
+    static const bool SOIL = control == SOIL_DRIVEN;
+    static const int SOIL_ZONES = SOIL ? ZONE_COUNT : 1;
+
+    //per zone
+    fastio::Pin relayIo_[ZONE_COUNT];
+    fastio::Pin switchIo_[ZONE_COUNT];
+    fastio::Pin soilIo_[SOIL_ZONES][2];
+    uint8_t state_[ZONE_COUNT];
+    uint8_t flowSlot_[ZONE_COUNT];
+    uint8_t flowFaults_[ZONE_COUNT];    //FlowFault bits of the last run, kept until a run ends cleanly
+    uint16_t cycles_[ZONE_COUNT];
+    uint8_t pulsesLeft_[ZONE_COUNT];    //of the automatic cycle after the current pulse
+    unsigned long lastStartSec_[ZONE_COUNT];
+    unsigned long lastStopSec_[ZONE_COUNT];
+    Q24_8 waterToday_[ZONE_COUNT];      //rolling day started at dayStartSec_
+    uint16_t drynessCount_[SOIL_ZONES][2];
+    ZoneMask soilDry_[2];               //per probe
+
+    //start arbiter, zones waiting for a start in request order
+    const uint8_t maxRunning_;
+    const uint32_t staggerMs_;
+    uint8_t queue_[ZONE_COUNT];
+    uint8_t queued_;
+    ZoneMask waiting_;
+    uint32_t lastGrantMs_;
+
+    //shared
+    const int timePerCycle_;
+    const Q24_8 waterPerCycle_;
+    uint8_t pulses_;
+    unsigned long soakSec_;
+    int pulseSec_;
+    Q24_8 waterPerPulse_;
+    Q24_8 waterPerDay_;
+    unsigned long timeBetweenTurnsOn_;
+    unsigned long dayStartSec_;
+    uint8_t potVersion_;
+    uint8_t etVersion_;
+    WaterSensor const* pWaterSensor_;
+    AirSensor const* pAirSensor_;
+
+    void countTimeBetweenTurnsOn();
+    bool budgetAllows(const uint8_t z) const;
+    uint16_t sharedGuards() const;
+    uint16_t zoneGuards(const uint8_t z, const unsigned long time_now_sec) const;
+    bool metered(const uint8_t z) const { return flowSlot_[z] != FLOW_NO_METER; }
+    bool pulseDone(const uint8_t z, const unsigned long run_sec) const;
+    uint8_t checkFlow(const uint8_t z, const unsigned long run_sec) const;
+    void finishRun(const uint8_t z, const State next, const unsigned long time_now_sec, const uint8_t faults);
+    void enterState(const uint8_t z, const State next, const unsigned long time_now_sec, const uint8_t faults);
+    void request(const uint8_t z);
+    void withdraw(const uint8_t z);
+  public:
+    static const bool HAS_SOIL_SENSOR = SOIL;
+    ZoneRegistry() = delete;
+    ZoneRegistry(const ZonePins* pins, const WaterSensor* pWS, const AirSensor* pAS,
+                 const uint8_t max_running = MAX_RUNNING_PUMPS, const uint32_t stagger_ms = PUMP_START_STAGGER_MS);
+    //soil segments of all zones, a probe reads high when dry
+    void readSoil();
+    unsigned long soilFirstReadMs() const { return SOIL ? 1000 : 0; }
+    unsigned long soilNextReadMs() const { return SOIL ? 5000 : 0; }
+    //one control tick of every pump
+    void controlPumps();
+    //ms before a control tick would change anything if the inputs stay, 0 - running, waiting or due now
+    //the times are in whole seconds of nowSec(), the last second before a change is left out
+    unsigned long quietMs() const;
+    void printInfo() const;
+    //pulses of an automatic cycle (1 - one continuous run) and the soak between them
+    void setCycleMode(const uint8_t pulses, const unsigned long soak_sec);
+    //zone chunk of a RECORD_STATUS starting at zone first, returns the first zone of the next chunk
+    uint8_t writeTelemetry(telemetry::Record& record, const uint8_t first) const;
+    //times are stored as ages, a reset counts as no time passed - the pump rather waits longer
+    void saveState(persist::Record& record) const;
+    void restoreState(persist::Record& record);
+    static const uint8_t STATE_SIZE = 4 + ZONE_COUNT * (SOIL ? 13 : 9);
+
+    State state(const uint8_t z) const { return (State)state_[z]; }
+    //debounced in the background, active low
+    bool switchOn(const uint8_t z) const { return !debounce::read(switchIo_[z]); }
+    bool soilWantsWater(const uint8_t z) const { return !SOIL || (soilDry_[0] & soilDry_[1]) >> z & 1; }
+    ZoneMask soilDry(const int probe) const { return SOIL ? soilDry_[probe] : 0; }
+    ZoneMask runningMask() const;
+    bool waiting(const uint8_t z) const { return waiting_ >> z & 1; }
+    uint16_t cycles(const uint8_t z) const { return cycles_[z]; }
+    uint8_t pulsesLeft(const uint8_t z) const { return pulsesLeft_[z]; }
+    int pulseSec() const { return pulseSec_; }
+    Q24_8 waterToday(const uint8_t z) const { return waterToday_[z]; }
+    Q24_8 waterPerDay() const { return waterPerDay_; }
+    unsigned long timeBetweenTurnsOn() const { return timeBetweenTurnsOn_; }
+};
+
+typedef ZoneRegistry<PUMP_CONTROL> SystemZones;
+
+#endif
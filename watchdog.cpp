@@ -0,0 +1,87 @@
+#include <arduino.h>
+#include <avr/wdt.h>
+#include "sysclock.h"
+#include "watchdog.h"
+
+#if defined(__AVR__)
+#define NOINIT __attribute__((section(".noinit")))
+#else
+#define NOINIT
+#endif
+
+namespace
+{
+  watchdog::Crash crash_ NOINIT;
+  bool crashed_ = false;
+
+  bool valid(const watchdog::Crash& crash)
+  {
+    return crash.magic == WATCHDOG_CRASH_MAGIC && crash.magicInverted == (uint16_t)~WATCHDOG_CRASH_MAGIC;
+  }
+}
+
+namespace watchdog
+{
+  Breadcrumb breadcrumb NOINIT;
+
+  void start()
+  {
+    crashed_ = valid(crash_);
+    if(!crashed_) crash_.resets = 0;
+    crash_.magic = 0;
+
+    breadcrumb.stage = STAGE_BOOT;
+    breadcrumb.stageMs = 0;
+
+    wdt_enable(WDTO_1S);
+#if defined(__AVR__)
+    WDTCSR |= _BV(WDIE);
+#endif
+  }
+
+  void mark(const uint8_t stage)
+  {
+    breadcrumb.stage = stage;
+    breadcrumb.stageMs = sysclock::nowMs();
+  }
+
+  void expired(const uint16_t pc)
+  {
+    crash_.last = breadcrumb;
+    crash_.pc = pc;
+    if(crash_.resets < 0xFF) ++crash_.resets;
+    crash_.magicInverted = (uint16_t)~WATCHDOG_CRASH_MAGIC;
+    crash_.magic = WATCHDOG_CRASH_MAGIC;
+#if defined(__AVR__)
+    for(;;);  //WDIE is cleared by the hardware, the next timeout resets
+#endif
+  }
+
+  const Crash* lastCrash()
+  {
+    return valid(crash_) ? &crash_ : nullptr;
+  }
+
+  bool writeTelemetry(telemetry::Record& record)
+  {
+    if(!crashed_) return false;
+
+    record.put8(crash_.last.stage);
+    record.put32(crash_.last.stageMs);
+    record.put16(crash_.pc);
+    record.put8(crash_.resets);
+    crashed_ = false;
+    return true;
+  }
+}
+
+#if defined(__AVR__)
+//naked: nothing is pushed, so the interrupted PC is right above the stack pointer
+//the handler never returns, so it is free to clobber registers
+ISR(WDT_vect, ISR_NAKED)
+{
+  asm volatile("clr __zero_reg__");
+  const uint8_t* sp = (const uint8_t*)SP;
+  watchdog::expired(((uint16_t)sp[1] << 8 | sp[2]) << 1);
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+const uint16_t WATCHDOG_CRASH_MAGIC = 0xD06E;
+
+//the watchdog runs in interrupt-then-reset mode: the first timeout captures the interrupted
+//program counter and the last breadcrumb, the second one resets the board
+//all of it lives in .noinit RAM, so the capture survives the reset and is reported after boot
+namespace watchdog
+{
+  enum Stage : uint8_t
+  {
+    STAGE_BOOT,
+    STAGE_CONTROL,      //readAndControl() outside of the tasks
+    STAGE_PRINT,        //printInfo()
+    STAGE_TELEMETRY,    //building the telemetry records
+    STAGE_SERIAL,       //serviceCommands(), serviceTrace() and telemetry::service()
+    STAGE_TASK = 0x10   //plus the scheduler task index
+  };
+
+  struct Breadcrumb
+  {
+    uint8_t stage;
+    uint32_t stageMs;
+  };
+
+  struct Crash
+  {
+    uint16_t magic;
+    uint16_t magicInverted;
+    Breadcrumb last;
+    uint16_t pc;          //byte address, as in the disassembly
+    uint8_t resets;       //watchdog resets in a row, any other reset (power on, external, brown-out) clears it
+  };
+
+  extern Breadcrumb breadcrumb;
+
+  //enables the watchdog once, wdt_reset() stays in the loop
+  void start();
+  void mark(const uint8_t stage);
+
+  //interrupt context, does not return on the board
+  void expired(const uint16_t pc);
+  //capture taken since start(), only the simulation ever gets to see it
+  const Crash* lastCrash();
+
+  //RECORD_RESET body, false when the last reset was not caused by the watchdog
+  bool writeTelemetry(telemetry::Record& record);
+}
+
+#endif